@@ -1,21 +1,22 @@
 #pragma once
 
 #include "config.hpp"
+#include "events.hpp"
 #include "flog.hpp"
+#include "io.hpp"
+#include "query.hpp"
 #include "util.hpp"
 
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 #include <stringzilla/stringzilla.hpp>
 
-#ifdef USE_REGEX
-#include <re2/re2.h>
-#endif // USE_REGEX
-
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <iterator>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -78,9 +79,29 @@ public:
 		std::string info;
 		std::string subs;
 		file<ashvardanian::stringzilla::string> text;
-		file<std::vector<config::timestamp_type> > timestamps;
+		struct {
+			std::string path;
+			class events data;
+		} events; // *.events, when each subtitle event starts.
 		std::string title;
 		std::int32_t upload_date; // time_since_epoch (seconds).
+		file<std::vector<std::uint32_t> > words; // Offset (into text) of every word, see util::words().
+		struct stamp { // What a *.info.json/*.json3 looked like when it got ingested, so that an unchanged one can be told apart from a changed one by stat alone (and a moved/touched one by its contents).
+			std::uint64_t size{0};
+			std::int64_t mtime{0}; // std::filesystem::file_time_type ticks.
+			std::uint64_t hash{0}; // util::xxh64() of the contents, 0 if unknown (archives from before stamps were a thing).
+
+			constexpr bool empty() const {return size == 0 && mtime == 0 && hash == 0;}
+		};
+		struct {
+			stamp info;
+			stamp subs;
+		} stamps;
+		struct {
+			std::uint64_t text{0};
+			std::uint64_t events{0};
+			std::uint64_t words{0};
+		} checksums; // util::xxh64() of the files as written, 0 if unknown. Checked on load, so that a torn write only costs re-ingesting the sources it hit.
 
 		inline bool load(rapidjson::Document::Object && i);
 	};
@@ -97,37 +118,16 @@ public:
 
 		auto _archive{util::read<std::string>(std::forward<T>(archive))};
 		rapidjson::Document document;
-
-		document.ParseInsitu(_archive.data());
-
-		if(!document.IsArray()) [[unlikely]] {
-			if(document.HasParseError()) [[likely]] {
-				flog::write(
-					util::format(
-						"Error parsing '%s': %zu: %s"
-						, util::c_str(std::forward<T>(archive))
-						, document.GetErrorOffset()
-						, rapidjson::GetParseError_En(document.GetParseError())
-					)
-					, flog::Level::warning
-				);
-			}
-
-			return;
-		}
-
-		const auto _document{document.GetArray()};
-
-		_sources.reserve(_document.Size());
-
-		for(const auto & i: _document) {
+		std::vector<std::string> timestamps_paths; // Per source, for the conversion below.
+		const auto load{[&](const rapidjson::Value & i) {
 			const auto
 				formats{i.FindMember("formats")}
 				, id{i.FindMember("id")}
 				, info{i.FindMember("info")}
 				, subs{i.FindMember("subs")}
 				, text{i.FindMember("text")}
-				, timestamps{i.FindMember("timestamps")}
+				, events{i.FindMember("events")}
+				, timestamps{i.FindMember("timestamps")} // Archives from before *.events were a thing.
 				, title{i.FindMember("title")}
 				, upload_date{i.FindMember("upload_date")}
 			;
@@ -138,28 +138,20 @@ public:
 				|| (info == i.MemberEnd() || !info->value.IsString())
 				|| (subs == i.MemberEnd() || !subs->value.IsString())
 				|| (text == i.MemberEnd() || !text->value.IsString())
-				|| (timestamps == i.MemberEnd() || !timestamps->value.IsString())
+				|| ((events == i.MemberEnd() || !events->value.IsString()) && (timestamps == i.MemberEnd() || !timestamps->value.IsString()))
 				|| (title == i.MemberEnd() || !title->value.IsString())
 				|| (upload_date == i.MemberEnd() || !upload_date->value.IsInt())
 			) [[unlikely]] {
-				continue; // TODO: Log warning.
+				return; // TODO: Log warning.
 			}
 
 			const std::string
 				_info{info->value.GetString(), info->value.GetStringLength()}
 				, _subs{subs->value.GetString(), subs->value.GetStringLength()}
 				, _text{text->value.GetString(), text->value.GetStringLength()}
-				, _timestamps{timestamps->value.GetString(), timestamps->value.GetStringLength()}
-			;
-
-			if(
-				!util::file_exists(_info)
-				|| !util::file_exists(_subs)
-				|| !util::file_exists(_text)
-				|| !util::file_exists(_timestamps)
-			) [[unlikely]] {
-				continue; // TODO: Log warning.
-			}
+				, _timestamps{timestamps != i.MemberEnd() && timestamps->value.IsString() ? std::string{timestamps->value.GetString(), timestamps->value.GetStringLength()} : std::string{}}
+				, _events{events != i.MemberEnd() && events->value.IsString() ? std::string{events->value.GetString(), events->value.GetStringLength()} : _timestamps.substr(0, _timestamps.rfind('.'))+".events"}
+			; // _info/_subs don't have to exist (anymore): they might've just been moved (or renamed), which whoever scans for new ones can tell by source::stamps. Sources whose files are gone for good are up to them to drop.
 
 			source source{
 				.formats = [&] {
@@ -226,22 +218,183 @@ public:
 				, .id = {id->value.GetString(), id->value.GetStringLength()}
 				, .info = std::move(_info)
 				, .subs = std::move(_subs)
-				, .text = decltype(source::text){_text}
-				, .timestamps = decltype(source::timestamps){_timestamps}
+				, .text = {}
+				, .events = {.path = _events, .data = {}}
 				, .title = {title->value.GetString(), title->value.GetStringLength()}
 				, .upload_date = static_cast<decltype(source::upload_date)>(upload_date->value.GetInt())
+				, .words = {}
+				, .stamps = {}
+				, .checksums = {}
 			};
 
+			source.text.path = _text;
+			if(const auto words{i.FindMember("words")}; words != i.MemberEnd() && words->value.IsString()) {
+				source.words.path = std::string{words->value.GetString(), words->value.GetStringLength()};
+			}
+			if(const auto stamps{i.FindMember("stamps")}; stamps != i.MemberEnd() && stamps->value.IsObject()) {
+				for(const auto & [key, stamp]: {std::pair{"info", &source.stamps.info}, std::pair{"subs", &source.stamps.subs}}) {
+					if(const auto j{stamps->value.FindMember(key)}; j != stamps->value.MemberEnd() && j->value.IsArray() && j->value.Size() == 3) {
+						const auto _stamp{j->value.GetArray()};
+
+						if(_stamp[0].IsUint64() && _stamp[1].IsInt64() && _stamp[2].IsUint64()) [[likely]] {
+							*stamp = {.size = _stamp[0].GetUint64(), .mtime = _stamp[1].GetInt64(), .hash = _stamp[2].GetUint64()};
+						}
+					}
+				}
+			}
+			if(const auto checksums{i.FindMember("checksums")}; checksums != i.MemberEnd() && checksums->value.IsArray() && checksums->value.Size() == 3) {
+				const auto _checksums{checksums->value.GetArray()};
+
+				if(_checksums[0].IsUint64() && _checksums[1].IsUint64() && _checksums[2].IsUint64()) [[likely]] {
+					source.checksums = {.text = _checksums[0].GetUint64(), .events = _checksums[1].GetUint64(), .words = _checksums[2].GetUint64()};
+				}
+			}
+
 			if(!source.formats.empty()) [[likely]] {
 				_sources.emplace_back(std::move(source));
+				timestamps_paths.emplace_back(_timestamps);
+			}
+		}};
+
+		document.ParseInsitu(_archive.data());
+
+		if(document.IsArray()) [[likely]] {
+			_sources.reserve(document.GetArray().Size());
+			timestamps_paths.reserve(document.GetArray().Size());
+
+			for(const auto & i: document.GetArray()) {
+				load(i);
+			}
+		} else if(document.HasParseError()) { // Torn by a crash (archive.json from before util::write_atomic(), that is), or edited by hand. Every source is on a line of its own (see store()), so whatever parses on its own gets to stay, and the rest gets ingested again.
+			flog::write(
+				util::format(
+					"Error parsing '%s': %zu: %s"
+					, util::c_str(std::forward<T>(archive))
+					, document.GetErrorOffset()
+					, rapidjson::GetParseError_En(document.GetParseError())
+				)
+				, flog::Level::warning
+			);
+
+			_archive = util::read<std::string>(std::forward<T>(archive)); // ParseInsitu() has made a mess of the first one.
+
+			for(std::string_view lines{_archive}; !lines.empty();) {
+				const auto end{lines.find('\n')};
+				auto line{lines.substr(0, end)};
+				rapidjson::Document _document;
+
+				lines.remove_prefix(end == lines.npos ? lines.size() : end+1);
+
+				if(line.ends_with(',')) {
+					line.remove_suffix(1);
+				}
+
+				if(!line.starts_with('{')) {
+					continue;
+				}
+
+				if(_document.Parse(line.data(), line.size()); _document.IsObject()) {
+					load(_document);
+				}
+			}
+
+			flog::write(util::format("Salvaged %zu source(s) from '%s'.", _sources.size(), util::c_str(std::forward<T>(archive))), flog::Level::warning);
+		} else {
+			return;
+		}
+
+		// The files themselves get read in batches (see io::read()) rather than one after another, so that a cold start is bound by the disk instead of syscall latency. Whatever doesn't exist (or can't be read) gets its source dropped (or, for *.words, derived).
+		std::vector<std::string> paths(_sources.size());
+		std::vector<bool> loaded(_sources.size(), true);
+
+		std::transform(_sources.begin(), _sources.end(), paths.begin(), [](const auto & x) {return x.text.path;});
+		for(std::size_t i{0}; auto & text: io::read<decltype(source::text.data)>(paths)) {
+			if(!text) [[unlikely]] {
+				loaded[i] = false; // TODO: Log warning.
+			} else if(const auto checksum{_sources[i].checksums.text}; checksum != 0 && util::xxh64(std::string_view{*text}) != checksum) [[unlikely]] {
+				flog::write(util::format("'%s' is damaged, its source will be ingested again.", paths[i].c_str()), flog::Level::warning);
+
+				loaded[i] = false;
+			} else {
+				_sources[i].text.data = std::move(*text);
+			}
+
+			++i;
+		}
+
+		std::transform(_sources.begin(), _sources.end(), paths.begin(), [](const auto & x) {return x.events.path;});
+		for(std::size_t i{0}; auto & events: io::read<std::string>(paths)) {
+			if(!events && loaded[i]) { // One-time conversion of the old *.timestamps: a uint16_t (seconds) for every 16 bytes of text.
+				if(std::vector<std::uint16_t> timestamps; !timestamps_paths[i].empty() && util::read(timestamps_paths[i], &timestamps)) {
+					std::vector<::events::event> _events;
+
+					for(std::size_t j{0}; j < timestamps.size(); ++j) {
+						if(j == 0 || timestamps[j] != timestamps[j-1]) {
+							_events.emplace_back(::events::event{.offset = j*16, .timestamp = config::timestamp_type{timestamps[j]}*1000});
+						}
+					}
+
+					::events{_events}.store(&events.emplace());
+
+					if(!util::write(paths[i], *events)) [[unlikely]] {
+						flog::write(util::format("Unable to write '%s'.", paths[i].c_str()), flog::Level::warning);
+
+						events.reset();
+					}
+				}
+			}
+
+			if(!events) [[unlikely]] {
+				loaded[i] = false; // TODO: Log warning.
+			} else if(const auto checksum{_sources[i].checksums.events}; loaded[i] && checksum != 0 && util::xxh64(*events) != checksum) [[unlikely]] {
+				flog::write(util::format("'%s' is damaged, its source will be ingested again.", paths[i].c_str()), flog::Level::warning);
+
+				loaded[i] = false;
+			} else {
+				_sources[i].events.data = ::events{std::string_view{*events}};
+			}
+
+			++i;
+		}
+
+		std::transform(_sources.begin(), _sources.end(), paths.begin(), [](const auto & x) {return x.words.path;});
+		for(std::size_t i{0}; auto & words: io::read<decltype(source::words.data)>(paths)) {
+			auto & source{_sources[i]};
+
+			if(words && (source.checksums.words == 0 || util::xxh64(std::string_view{reinterpret_cast<const char *>(words->data()), words->size()*sizeof(std::uint32_t)}) == source.checksums.words)) [[likely]] {
+				source.words.data = std::move(*words);
+			} else if(loaded[i]) { // Archives from before *.words were a thing (or a damaged one). Deriving these is cheap enough, we just won't have a file to point to until the archive gets stored again.
+				source.words.path.clear();
+				source.checksums.words = 0;
+				util::words(std::string_view{source.text.data}, [&source](const std::size_t offset, const std::size_t) {
+					source.words.data.emplace_back(static_cast<std::uint32_t>(offset));
+				});
 			}
+
+			++i;
 		}
 
+		std::size_t size{0};
+
+		for(std::size_t i{0}; i < _sources.size(); ++i) {
+			if(loaded[i]) [[likely]] {
+				if(i != size) {
+					_sources[size] = std::move(_sources[i]);
+				}
+
+				++size;
+			}
+		}
+
+		_sources.erase(_sources.begin()+static_cast<std::ptrdiff_t>(size), _sources.end());
+
 		std::sort(
 			_sources.begin()
 			, _sources.end()
 			, [](const auto & lhs, const auto & rhs) {return lhs.upload_date > rhs.upload_date;}
 		);
+
+		hot();
 	}
 
 	archive(const archive &) = delete;
@@ -250,7 +403,7 @@ public:
 	constexpr archive & operator =(archive &&) = default;
 
 	operator bool() const {return !empty();}
-	source & operator [](const std::size_t i) {return _sources[i];}
+	source & operator [](const std::size_t i) {return _sources[i];} // Don't touch text/upload_date through this, see _hot.
 	const source & operator [](const std::size_t i) const {return _sources[i];}
 
 	template<typename T>
@@ -266,66 +419,133 @@ public:
 			)
 			, std::forward<T>(source)
 		);
+
+		hot();
+	}
+
+	void append( // Same as appending them one by one, minus rebuilding _hot every time.
+		std::vector<source> && sources
+	) {
+		const auto size{static_cast<std::ptrdiff_t>(_sources.size())};
+		const auto newer{[](const auto & lhs, const auto & rhs) {return lhs.upload_date > rhs.upload_date;}};
+
+		std::move(sources.begin(), sources.end(), std::back_inserter(_sources));
+		std::sort(_sources.begin()+size, _sources.end(), newer);
+		std::inplace_merge(_sources.begin(), _sources.begin()+size, _sources.end(), newer);
+
+		hot();
 	}
 
 	constexpr auto begin() {return _sources.begin();}
 	constexpr auto begin() const {return _sources.begin();}
 	constexpr auto rbegin() {return _sources.rbegin();}
 	constexpr auto rbegin() const {return _sources.rbegin();}
+	constexpr auto data() const {return _sources.data();}
 	constexpr bool empty() const {return _sources.empty();}
 	constexpr auto end() {return _sources.end();}
 	constexpr auto end() const {return _sources.end();}
 	constexpr auto rend() {return _sources.rend();}
 	constexpr auto rend() const {return _sources.rend();}
-	template<typename S, typename F> void find(S && substr, F && f) const;
-	void reserve(const std::size_t new_cap) {_sources.reserve(new_cap);}
+	template<typename P, typename F> void find(const P & pattern, F && f) const;
+	template<typename P, typename F> void find(std::span<const source> sources, const P & pattern, F && f) const;
+	template<typename P, typename F> void find(const source & source, const P & pattern, F && f) const;
+	template<typename F> void refine(std::span<const source> sources, std::string_view literal, std::size_t shift, std::span<const query::position> previous, F && f) const;
+	inline std::span<const source> slice(std::int64_t from, std::int64_t to) const;
+	inline std::size_t seek(const source & source, config::timestamp_type timestamp) const;
+	template<typename F> void timestamps(const source & source, std::size_t begin, std::size_t end, F && f) const;
+	template<typename F> void erase_if(F && f) {std::erase_if(_sources, std::forward<F>(f)); hot();}
+	void reserve(const std::size_t new_cap) {_sources.reserve(new_cap); hot();}
 	constexpr auto size() const {return _sources.size();}
 
-	void store(
+	bool store( // As archive.json, one source per line.
 		std::FILE * file
 	) const {
-		std::fputc('[', file);
-		for(char separator{' '}; const auto & i: _sources) {
-			std::fprintf(file, "%c{\"formats\":[", separator);
+		auto & json{util::thread_buffer()};
+
+		json.reserve(_sources.size()*1024); // Rough estimate, formats make up most of it.
+
+		json += "[\n";
+		for(std::string_view separator; const auto & i: _sources) {
+			util::strcat(&json, separator, "{\"formats\":[");
 			for(char _separator{' '}; const auto & j: i.formats) {
-				std::fprintf(
-					file
-					, "%c{\"container\":\"%s\",\"format_id\":\"%s\",\"filesize\":%ju"
+				util::strcat(
+					&json
 					, _separator
-					, j.container.c_str()
-					, j.format_id.c_str()
-					, std::uintmax_t{j.filesize}
+					, "{\"container\":\""
+					, util::json_escaped{j.container}
+					, "\",\"format_id\":\""
+					, util::json_escaped{j.format_id}
+					, "\",\"filesize\":"
+					, j.filesize
 				);
 				if(j.video.has_value()) {
-					std::fprintf(file, ",\"video\":{\"fps\":%i,\"width\":%u,\"height\":%u}", j.video->fps, j.video->width, j.video->height);
+					util::strcat(&json, ",\"video\":{\"fps\":", j.video->fps, ",\"width\":", j.video->width, ",\"height\":", j.video->height, '}');
 				}
 				if(j.audio.has_value()) {
-					std::fprintf(file, ",\"audio\":{}");
+					json += ",\"audio\":{}";
 				}
-				std::fputc('}', file);
+				json += '}';
 
 				_separator = ',';
 			}
-			std::fputc(']', file);
-			std::fprintf(
-				file
-				, ",\"id\":\"%s\",\"info\":\"%s\",\"subs\":\"%s\",\"text\":\"%s\",\"timestamps\":\"%s\",\"title\":\"%s\",\"upload_date\":%ji}"
-				, i.id.c_str()
-				, util::json_escape(i.info).c_str()
-				, util::json_escape(i.subs).c_str()
-				, util::json_escape(i.text.path).c_str()
-				, util::json_escape(i.timestamps.path).c_str()
-				, util::json_escape(i.title).c_str()
-				, std::intmax_t{i.upload_date}
+			util::strcat(
+				&json
+				, "],\"id\":\""
+				, util::json_escaped{i.id}
+				, "\",\"info\":\""
+				, util::json_escaped{i.info}
+				, "\",\"subs\":\""
+				, util::json_escaped{i.subs}
+				, "\",\"text\":\""
+				, util::json_escaped{i.text.path}
+				, "\",\"events\":\""
+				, util::json_escaped{i.events.path}
+				, "\",\"title\":\""
+				, util::json_escaped{i.title}
+				, "\",\"upload_date\":"
+				, i.upload_date
 			);
+			if(!i.words.path.empty()) {
+				util::strcat(&json, ",\"words\":\"", util::json_escaped{i.words.path}, '"');
+			}
+			if(i.checksums.text != 0 || i.checksums.events != 0 || i.checksums.words != 0) {
+				util::strcat(&json, ",\"checksums\":[", i.checksums.text, ',', i.checksums.events, ',', i.checksums.words, ']');
+			}
+			if(!i.stamps.info.empty() || !i.stamps.subs.empty()) {
+				util::strcat(
+					&json
+					, ",\"stamps\":{\"info\":[", i.stamps.info.size, ',', i.stamps.info.mtime, ',', i.stamps.info.hash
+					, "],\"subs\":[", i.stamps.subs.size, ',', i.stamps.subs.mtime, ',', i.stamps.subs.hash
+					, "]}"
+				);
+			}
+			json += '}';
 
-			separator = ',';
+			separator = ",\n";
 		}
-		std::fputc(']', file);
+		json += "\n]";
+
+		return std::fwrite(json.data(), sizeof(char), json.size(), file) == json.size();
 	}
 
 private:
+	void hot( // Rebuilds _hot, has to be called whenever _sources changes (texts can live inside of source, thanks to SSO).
+	) {
+		_hot.texts.clear();
+		_hot.upload_dates.clear();
+		_hot.texts.reserve(_sources.size());
+		_hot.upload_dates.reserve(_sources.size());
+		for(const auto & i: _sources) {
+			_hot.texts.emplace_back(i.text.data.view());
+			_hot.upload_dates.emplace_back(i.upload_date);
+		}
+	}
+
 	std::vector<source> _sources;
+	struct {
+		std::vector<ashvardanian::stringzilla::string_view> texts;
+		std::vector<decltype(source::upload_date)> upload_dates;
+	} _hot; // Whatever find()/slice() look at for *every* source, stored separately (and contiguously) so that scanning lots of (short) sources doesn't drag the rest of source (formats, paths, title, events...) through the cache. Same order as _sources.
 };
 
 inline
@@ -469,49 +689,146 @@ bool archive::source::load(
 	return true;
 }
 
-template<typename S, typename F>
+template<typename P, typename F>
 void archive::find
 (
-	S && substr
+	const P & pattern // query::pattern or query::phrases, or anything else that has find(text, f(offset, size, ...)).
 	, F && f
 ) const {
-#ifdef USE_REGEX
-	const re2::RE2 regex{std::string{'('}+std::forward<S>(substr)+std::string{')'}}; // FIXME: FindAndConsume(...) fails unless the *entire* expression is a group (or we omit the result arg altogether). I don't know enough about regexes to know what kind of side effects this can have, but it seems to just work(tm).
+	find(std::span<const source>{_sources}, pattern, f);
+}
 
-	if(!regex.ok()) {
-		return; // TODO: Log error.
+template<typename P, typename F>
+void archive::find
+(
+	const std::span<const source> sources // Some (contiguous) part of this archive, see slice().
+	, const P & pattern
+	, F && f
+) const {
+	const auto begin{static_cast<std::size_t>(sources.data()-_sources.data())};
+
+	for(auto i{begin}; i < begin+sources.size(); ++i) {
+		pattern.find(_hot.texts[i], [&](const std::size_t offset, const std::size_t size, const auto ... argv) { // Only now does the (cold) source get touched.
+			const auto & source{_sources[i]};
+
+			f(
+				std::string_view{source.text.data}
+				, offset
+				, size
+				, source.events.data.timestamp_at(offset)
+				, source
+				, argv ...
+			);
+		});
 	}
+}
 
-	for(absl::string_view result; const auto & i: _sources) {
-		absl::string_view text(i.text.data.data(), i.text.data.size());
+template<typename P, typename F>
+void archive::find
+(
+	const source & source // Only this one.
+	, const P & pattern
+	, F && f
+) const {
+	pattern.find(source.text.data, [&](const std::size_t offset, const std::size_t size, const auto ... argv) {
+		f(
+			std::string_view{source.text.data}
+			, offset
+			, size
+			, source.events.data.timestamp_at(offset)
+			, source
+			, argv ...
+		);
+	});
+}
 
-		while(re2::RE2::FindAndConsume(&text, regex, &result)) {
-			const auto j{text.data()-i.text.data.data()};
+template<typename F>
+void archive::refine
+(
+	const std::span<const source> sources // Same as find()'s, matches outside of it are ignored.
+	, const std::string_view literal
+	, const std::size_t shift // See query::refines().
+	, const std::span<const query::position> previous // Matches of the previous literal, see query::session::hits.
+	, F && f // Same as find()'s.
+) const {
+	const auto
+		begin{static_cast<std::size_t>(sources.data()-_sources.data())}
+		, end{begin+sources.size()}
+	;
+	std::size_t source{_sources.size()}, _end{0};
+
+	for(const auto & i: std::span{
+		std::partition_point(previous.begin(), previous.end(), [&](const auto & x) {return x.source < begin;})
+		, std::partition_point(previous.begin(), previous.end(), [&](const auto & x) {return x.source < end;})
+	}) {
+		if(i.source != source) {
+			source = i.source;
+			_end = 0;
+		}
 
-			std::forward<F>(f)(
-				std::string_view(i.text.data.data(), i.text.data.size())
-				, j-result.size()
-				, result.size()
-				, i.timestamps.data[j/(config::timestamp_length*sizeof(config::timestamp_type))]
-				, i
-			);
+		if(i.offset < shift+_end) { // Overlaps the previous match (or starts before the text does).
+			continue;
 		}
-	}
-#else // !USE_REGEX
-	for(const auto length{util::strlen(std::forward<S>(substr))}; const auto & i: _sources) {
-		for(
-			std::size_t j{i.text.data.find(std::forward<S>(substr))}
-			; j != i.text.data.npos
-			; j = i.text.data.find(std::forward<S>(substr), j+length)
-		) {
-			std::forward<F>(f)(
-				std::string_view{i.text.data}
-				, j
-				, substr.size()
-				, i.timestamps.data[j/(config::timestamp_length*sizeof(config::timestamp_type))]
-				, i
-			);
+
+		const auto & _source{_sources[i.source]};
+		const auto text{std::string_view{_source.text.data}};
+		const auto offset{i.offset-shift};
+
+		if(text.substr(offset, literal.size()) != literal) {
+			continue;
 		}
+
+		_end = offset+literal.size();
+
+		f(
+			text
+			, offset
+			, literal.size()
+			, _source.events.data.timestamp_at(offset)
+			, _source
+		);
 	}
-#endif // USE_REGEX
+}
+
+inline
+std::span<const archive::source> archive::slice( // Sources uploaded in [from, to] (seconds since epoch, inclusive), which is a contiguous range since _sources are sorted by upload_date.
+	const std::int64_t from
+	, const std::int64_t to
+) const {
+	const auto & dates{_hot.upload_dates};
+	const auto begin{std::partition_point(dates.begin(), dates.end(), [&](const auto x) {return x > to;})};
+	const auto end{std::partition_point(begin, dates.end(), [&](const auto x) {return x >= from;})};
+
+	return {_sources.data()+(begin-dates.begin()), static_cast<std::size_t>(end-begin)};
+}
+
+template<typename F>
+void archive::timestamps
+( // f(offset, timestamp) for [begin, end) of source.text, at begin and wherever an event starts after it.
+	const source & source
+	, const std::size_t begin
+	, const std::size_t end
+	, F && f
+) const {
+	const auto & events{source.events.data};
+	auto i{events.at(begin)};
+
+	if(i == events.size()) { // begin is before the first event.
+		i = 0;
+	}
+
+	for(; i < events.size() && events.offset(i) < end; ++i) {
+		f(std::max(begin, events.offset(i)), events.timestamp(i));
+	}
+}
+
+inline
+std::size_t archive::seek( // Offset (into source.text) of the first event at or after timestamp, text.size() if there's none.
+	const source & source
+	, const config::timestamp_type timestamp
+) const {
+	const auto & events{source.events.data};
+	const auto i{events.seek(timestamp)};
+
+	return i < events.size() ? std::min(events.offset(i), std::size_t{source.text.data.size()}) : std::size_t{source.text.data.size()};
 }
@@ -8,7 +8,7 @@
 
 namespace config {
 
-using timestamp_type = std::uint16_t; // uint16_t is enough to address approximately 18 hours of "content", otherwise use uint32_t. Using uint16_t does *not* reduce file size, but it *does* increase precision.
+using timestamp_type = std::uint32_t; // Milliseconds, which is enough for ~49 days of "content". This is only what timestamps look like in memory/responses: class events picks the number of bits per timestamp (and per offset) for every source on its own, based on its length and how many events it has, so there's nothing to tune per archive.
 
 constexpr auto log_level{flog::Level::info}; // debug > info > warning > error > none.
 constexpr auto server_listen_ip{"127.0.0.1"};
@@ -28,10 +28,36 @@ constexpr auto skip{std::array{ // Remove these substrings from the subs cache.
 	, std::string_view{"-"}
 #endif
 }};
-constexpr auto results_per_page{2048}; // Because trying to do this using JS/HTML was a *bad* idea, but I'm invested now.
+constexpr auto results_per_page{65536}; // Because trying to do this using JS/HTML was a *bad* idea, but I'm invested now. The client only creates the rows that are actually visible, so this mostly limits the amount of scrolling per page.
+constexpr auto regex_cache_size{64}; // Number of compiled regexes to keep around (USE_REGEX only).
+constexpr auto regex_max_mem{std::int64_t{8}<<20}; // RE2's memory budget (per regex), most of which goes to the DFA cache. Patterns that exceed it fail to compile.
+constexpr auto buffer_size_max{std::size_t{1}<<16}; // Per-thread buffers reused between searches (hits, results, ...) that grew past this many elements get freed afterwards instead.
+constexpr auto sessions_max{256}; // Number of clients whose last search is kept around for refinement ("mald" -> "maldavius" only looks at the hits of "mald").
+constexpr auto session_hits_max{std::size_t{1}<<20}; // Searches with more hits than that aren't kept (they take up 16 bytes per hit).
+constexpr auto phrases_max{4096}; // Max number of phrases per batch search (POST({"archive": ..., "phrases": [...]})).
+constexpr auto phrases_size_max{std::size_t{1}<<14}; // Max total length (bytes) of those phrases. The automaton takes up to 1 KiB per byte of them (one state per byte when there are no common prefixes), so ~16 MiB per request.
+constexpr auto rank_max{100}; // Max number of sources returned by a ranked search (POST({..., "rank": k})).
+constexpr auto bm25_k1{1.2}; // How quickly repeating a word stops mattering.
+constexpr auto bm25_b{0.75}; // How much longer streams get penalized for having more words in them.
+constexpr auto suggest_max{20}; // Max number of suggestions per POST({"suggest": ...}).
+constexpr auto suggest_bigrams_max{std::size_t{1}<<20}; // Number of distinct bigrams kept around while building the suggestions dictionary, which bounds its memory usage (a few hundred bytes per bigram, peak).
+constexpr auto suggest_bigrams_min{2}; // Bigrams that show up less often than that don't get suggested.
+constexpr auto trends_ngram_max{4}; // Longest phrase (in words) considered by POST({"trends": ...}).
+constexpr auto trends_sketch_width{std::size_t{1}<<21}; // Count-Min sketch size, which is all the memory trends need (apart from the candidates): width*depth*4 bytes, no matter how large the archive is. Wider means more accurate counts.
+constexpr auto trends_sketch_depth{4};
+constexpr auto trends_top{50}; // Phrases per month.
+constexpr auto trends_min_count{5}; // Phrases said less often than that (in a month) are just noise.
+constexpr auto ingest_readers{2}; // Threads reading *.info.json/*.json3 during ingestion. More than a couple only makes an HDD seek more.
+constexpr auto ingest_queue_size{32}; // Files read (or parsed) ahead of whoever's next in the ingestion pipeline, which bounds its memory usage.
+constexpr auto ingest_batch_size{64}; // Sources written (and appended to the archive) at a time.
+constexpr auto ingest_read_size{16}; // Sources whose files get read (see io::read()) in one go, per reader.
+constexpr auto io_depth{256u}; // Files in flight at a time in io::read(). NVMe needs a deep queue to get anywhere near its bandwidth, an HDD doesn't care either way.
+constexpr auto io_threads{16}; // io::read()'s fallback for when there's no io_uring (and io::sync()), each blocking on one file at a time. Shared by everyone, and whoever's waiting on them helps out.
 constexpr auto min_search_size{3}; // Min length of a search term. 1 is obviously useless, 2 is (more) manageable but realistically this should be set to something like 3 or 4.
 constexpr auto substr_size_max{256}; // Max length of substring(s) returned by the search. Lower values reduce bandwidth, but also "reduce" context.
 constexpr auto substr_size_min{32};
-constexpr auto timestamp_length{8}; // Timestamps are written every (timestamp_length*sizeof(timestamp_type))'th *byte* of input string. Lower values increase search precision, but increase *.timestamps' size.
+constexpr auto substr_size_default{64}; // When the request doesn't say. Most snippets never get read, let alone expanded, see POST({"expand": ...}).
+constexpr auto expand_radius_max{2048}; // Max context (code points, each side of the hit) returned by POST({"expand": ...}).
+constexpr auto transcript_size_max{std::size_t{1}<<16}; // Max text (bytes) returned by POST({"transcript": ...}).
 
 } // namespace config
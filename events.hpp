@@ -0,0 +1,116 @@
+#pragma once
+
+#include "config.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class events { // Subtitle events, i.e. (offset into source::text, start time) pairs, both of them non-decreasing. Replaces the old per-block *.timestamps (which only had seconds, and repeated them every few bytes).
+public:
+	/*
+	*.events:
+		(
+			varint(offset-(previous offset))
+			varint(timestamp-(previous timestamp)) // Milliseconds.
+		)*
+	*/
+
+	struct event {
+		std::size_t offset;
+		config::timestamp_type timestamp;
+	};
+
+	events() = default;
+
+	explicit events(
+		const std::span<const event> events // Sorted by offset, timestamps are clamped so that they never go backwards.
+	) {
+		build(events);
+	}
+
+	explicit events(
+		std::string_view data // *.events
+	) {
+		std::vector<event> _events;
+
+		for(event previous{0, 0}; !data.empty();) {
+			std::size_t offset;
+			config::timestamp_type timestamp;
+
+			if(
+				!util::varint(&data, &offset)
+				|| !util::varint(&data, &timestamp)
+			) [[unlikely]] {
+				break;
+			}
+
+			previous = {previous.offset+offset, static_cast<config::timestamp_type>(previous.timestamp+timestamp)};
+			_events.emplace_back(previous);
+		}
+
+		build(_events);
+	}
+
+	std::size_t size() const {return _offsets.size();}
+	bool empty() const {return _offsets.empty();}
+	std::size_t offset(const std::size_t i) const {return static_cast<std::size_t>(_offsets[i]);}
+	config::timestamp_type timestamp(const std::size_t i) const {return static_cast<config::timestamp_type>(_timestamps[i]);}
+
+	std::size_t at( // Index of the event offset belongs to (the last one that starts at or before it), size() if there's none.
+		const std::size_t offset
+	) const {
+		const auto i{_offsets.lower_bound(std::uint64_t{offset}+1)};
+
+		return i > 0 ? i-1 : size();
+	}
+
+	config::timestamp_type timestamp_at( // Start time of whatever was being said at offset.
+		const std::size_t offset
+	) const {
+		const auto i{at(offset)};
+
+		return i < size() ? timestamp(i) : 0;
+	}
+
+	std::size_t seek( // Index of the first event that starts at or after timestamp, size() if there's none.
+		const config::timestamp_type timestamp
+	) const {
+		return _timestamps.lower_bound(timestamp);
+	}
+
+	void store( // As *.events.
+		std::string * data
+	) const {
+		for(std::size_t i{0}; i < size(); ++i) {
+			util::varint(data, offset(i)-(i > 0 ? offset(i-1) : 0));
+			util::varint(data, timestamp(i)-(i > 0 ? timestamp(i-1) : 0));
+		}
+	}
+
+	std::size_t bytes() const {return _offsets.bytes()+_timestamps.bytes();}
+
+private:
+	void build(
+		const std::span<const event> events
+	) {
+		std::vector<std::uint64_t> offsets, timestamps;
+
+		offsets.reserve(events.size());
+		timestamps.reserve(events.size());
+		for(const auto & i: events) {
+			offsets.emplace_back(i.offset);
+			timestamps.emplace_back(std::max<std::uint64_t>(i.timestamp, timestamps.empty() ? 0 : timestamps.back()));
+		}
+
+		_offsets = util::elias_fano{offsets};
+		_timestamps = util::elias_fano{timestamps};
+	}
+
+	util::elias_fano _offsets;
+	util::elias_fano _timestamps;
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+#include "config.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef USE_IO_URING
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+#endif // USE_IO_URING
+
+namespace io { // Reading a lot of files at once. One at a time (open, seek, read, close, repeat) spends most of its time waiting on syscalls rather than the disk, especially on a cold cache.
+
+namespace detail {
+
+template<typename T>
+constexpr bool readable = // Same as util::read().
+	std::ranges::contiguous_range<T>
+	&& !std::is_same_v<typename T::value_type, void>
+	&& requires(T x) {x.resize({});}
+	&& requires(T x) {x.data();}
+	&& requires(T x) {x.size();}
+;
+
+#ifdef USE_IO_URING
+template<typename T>
+bool read_uring( // statx -> openat -> read (until there's nothing left) -> close for every file, with up to config::io_depth of them in flight. Returns false if there's no io_uring to speak of (old kernel, seccomp, sysctl kernel.io_uring_disabled, ...), in which case nothing's been read.
+	const std::span<const std::string> paths
+	, std::vector<std::optional<T> > * result
+) {
+	struct ring { // One per thread (that reads anything), set up (and probed) the first time it does, and kept around until it exits.
+		io_uring _ring;
+		bool ok;
+
+		ring(): ok{io_uring_queue_init(config::io_depth, &_ring, 0) == 0} {
+			if(!ok) [[unlikely]] {
+				return;
+			}
+
+			const auto probe{io_uring_get_probe_ring(&_ring)};
+
+			ok = // Otherwise everything would come back as -EINVAL, i.e. "missing".
+				probe != nullptr
+				&& io_uring_opcode_supported(probe, IORING_OP_STATX)
+				&& io_uring_opcode_supported(probe, IORING_OP_OPENAT)
+				&& io_uring_opcode_supported(probe, IORING_OP_READ)
+				&& io_uring_opcode_supported(probe, IORING_OP_CLOSE)
+			;
+
+			if(probe != nullptr) [[likely]] {
+				io_uring_free_probe(probe);
+			}
+
+			if(!ok) [[unlikely]] {
+				io_uring_queue_exit(&_ring);
+			}
+		}
+		~ring() {if(ok) io_uring_queue_exit(&_ring);}
+	};
+
+	thread_local ring ring;
+
+	if(!ring.ok) [[unlikely]] {
+		return false;
+	}
+
+	enum class op {statx, openat, read, close};
+
+	struct file {
+		op stage{op::statx};
+		int fd{-1};
+		std::size_t size{0}; // Bytes.
+		std::size_t done{0};
+		struct statx statx;
+	};
+
+	std::vector<file> files(paths.size());
+	std::size_t next{0}, in_flight{0};
+
+	const auto sqe{[&](const std::size_t i) {
+		auto _sqe{io_uring_get_sqe(&ring._ring)};
+
+		if(_sqe == nullptr) [[unlikely]] { // Can't really happen, there's never more than config::io_depth of them waiting.
+			io_uring_submit(&ring._ring);
+			_sqe = io_uring_get_sqe(&ring._ring);
+		}
+
+		io_uring_sqe_set_data64(_sqe, i);
+
+		return _sqe;
+	}};
+	const auto read{[&](const std::size_t i) {
+		auto & _file{files[i]};
+
+		io_uring_prep_read(
+			sqe(i)
+			, _file.fd
+			, reinterpret_cast<char *>((*result)[i]->data())+_file.done
+			, static_cast<unsigned>(std::min<std::size_t>(_file.size-_file.done, std::size_t{1} << 30))
+			, _file.done
+		);
+	}};
+	const auto close{[&](const std::size_t i) {
+		files[i].stage = op::close;
+		io_uring_prep_close(sqe(i), files[i].fd);
+	}};
+
+	while(next < paths.size() || in_flight > 0) {
+		for(; next < paths.size() && in_flight < config::io_depth; ++next, ++in_flight) {
+			io_uring_prep_statx(sqe(next), AT_FDCWD, paths[next].c_str(), 0, STATX_TYPE | STATX_SIZE, &files[next].statx);
+		}
+
+		if(io_uring_submit_and_wait(&ring._ring, 1) < 0) [[unlikely]] {
+			continue; // -EINTR, most likely.
+		}
+
+		unsigned head, count{0};
+		io_uring_cqe * cqe;
+
+		io_uring_for_each_cqe(&ring._ring, head, cqe) {
+			const auto i{static_cast<std::size_t>(cqe->user_data)};
+			const auto res{cqe->res};
+			auto & _file{files[i]};
+			auto & _result{(*result)[i]};
+
+			++count;
+
+			switch(_file.stage) {
+			case op::statx:
+				if(
+					res < 0
+					|| !S_ISREG(_file.statx.stx_mode)
+				) {
+					--in_flight; // Doesn't exist (or isn't a file), so it stays std::nullopt.
+
+					break;
+				}
+
+				_file.size = static_cast<std::size_t>(_file.statx.stx_size)/sizeof(typename T::value_type)*sizeof(typename T::value_type);
+				_result.emplace();
+
+				if(!util::resize(&*_result, _file.size/sizeof(typename T::value_type))) [[unlikely]] {
+					_result.reset();
+					--in_flight;
+
+					break;
+				}
+
+				_file.stage = op::openat;
+				io_uring_prep_openat(sqe(i), AT_FDCWD, paths[i].c_str(), O_RDONLY | O_CLOEXEC, 0);
+
+				break;
+			case op::openat:
+				if(res < 0) [[unlikely]] {
+					_result.reset();
+					--in_flight;
+
+					break;
+				}
+
+				_file.fd = res;
+
+				if(_file.size == 0) {
+					close(i);
+				} else {
+					_file.stage = op::read;
+					read(i);
+				}
+
+				break;
+			case op::read:
+				if(res < 0) [[unlikely]] {
+					_result.reset(); // Same as util::read().
+					close(i);
+
+					break;
+				}
+
+				_file.done += static_cast<std::size_t>(res);
+
+				if(res > 0 && _file.done < _file.size) { // Short read (or more than fits in one).
+					read(i);
+				} else {
+					if(_file.done < _file.size) [[unlikely]] { // Got shorter since statx.
+						util::resize(&*_result, _file.done/sizeof(typename T::value_type));
+					}
+
+					close(i);
+				}
+
+				break;
+			case op::close:
+				--in_flight;
+
+				break;
+			}
+		}
+
+		io_uring_cq_advance(&ring._ring, count);
+	}
+
+	return true;
+}
+#endif // USE_IO_URING
+
+inline
+util::pool & threads( // Shared by every io::read() (without io_uring) and io::sync(), each thread blocking on one file at a time. Started the first time anyone needs it, rather than once per call.
+) {
+	static util::pool pool{config::io_threads};
+
+	return pool;
+}
+
+template<typename T>
+void read_threads( // util::read() on threads(), which keeps about as many requests in flight.
+	const std::span<const std::string> paths
+	, std::vector<std::optional<T> > * result
+) {
+	threads().run(paths.size(), [&](const std::size_t i) {
+		T x;
+
+		if(
+			util::file_exists(paths[i]) // Otherwise a directory "opens" just fine, and has a size of LONG_MAX.
+			&& util::read(paths[i], &x)
+		) [[likely]] {
+			(*result)[i] = std::move(x);
+		}
+	});
+}
+
+} // namespace detail
+
+template<typename T> requires detail::readable<T>
+std::vector<std::optional<T> > read( // util::read() for every path, all at once. Missing files (and errors) are std::nullopt, empty ones aren't.
+	const std::span<const std::string> paths
+) {
+	std::vector<std::optional<T> > result(paths.size());
+
+	if(paths.empty()) {
+		return result;
+	}
+
+#ifdef USE_IO_URING
+	if(detail::read_uring(paths, &result)) [[likely]] {
+		return result;
+	}
+#endif // USE_IO_URING
+
+	detail::read_threads(paths, &result);
+
+	return result;
+}
+
+inline
+bool sync( // util::sync() for every path, all at once. Concurrent fsyncs get folded into the same journal commit (by ext4, XFS, ...), so a batch of them costs about as much as a single one. Returns whether all of them succeeded.
+	const std::span<const std::string> paths
+) {
+	std::atomic<bool> result{true};
+
+	detail::threads().run(paths.size(), [&](const std::size_t i) {
+		if(!util::sync(paths[i])) [[unlikely]] {
+			result.store(false, std::memory_order_relaxed);
+		}
+	});
+
+	return result.load();
+}
+
+} // namespace io
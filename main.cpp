@@ -1,8 +1,14 @@
 #include "archive.hpp"
 #include "config.hpp"
 #include "flog.hpp"
+#include "io.hpp"
+#include "query.hpp"
 #include "sub/json3.hpp"
+#include "suggest.hpp"
+#include "trends.hpp"
 #include "util.hpp"
+#include "watchlist.hpp"
+#include "word_index.hpp"
 
 #include <cmrc/cmrc.hpp>
 #include <httplib.h>
@@ -10,10 +16,17 @@
 
 CMRC_DECLARE(rc);
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <clocale>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifdef GetObject
 #undef GetObject // httplib #includes <Windows.h> which pollutes global namespace with its bullshit.
@@ -44,6 +57,7 @@ config.example.json:
 	{
 		{"name": "Maldavius Figtree", "path": "/path/to/subs", "icon": "/path/to/icon/image.{png,webp,jp(e)?g"}
 		, {"name": "Icon Is Optional", "path": "/path/to/subs"}
+		, {"name": "So Is Watchlist", "path": "/path/to/subs", "watchlist": ["search term", "another one"]}
 	}
 
 "subs" can (and probably should) be obtained by running the following command:
@@ -60,9 +74,15 @@ config.example.json:
 		std::string path;
 		std::string icon;
 		std::string name;
+		std::vector<std::string> watchlist; // Searched for in every newly ingested source, hits go to cache_dir/name/watchlist/*.hits.
+		word_index words; // For POST({..., "words": true}).
+		class suggest suggest; // For POST({"suggest": ...}).
+		std::shared_ptr<const std::string> trends; // For POST({"trends": ...}), nullptr until they're ready. Guarded by trends_mutex.
 	};
 
 	std::vector<_archive> archives;
+	std::mutex trends_mutex;
+	std::vector<std::size_t> trends_stale; // Archives whose trends.json is missing or stale, see trends_thread.
 	std::string cache_dir;
 	std::string server_listen_ip{config::server_listen_ip};
 	std::remove_cvref_t<decltype(config::server_listen_port)> server_listen_port{config::server_listen_port};
@@ -110,6 +130,7 @@ config.example.json:
 				name{i.FindMember("name")}
 				, path{i.FindMember("path")}
 				, icon{i.FindMember("icon")}
+				, watchlist{i.FindMember("watchlist")}
 			;
 
 			if(
@@ -197,11 +218,45 @@ config.example.json:
 				_icon = "data:image/webp;base64,"+util::base64_encode(static_cast<const char *>(file.cbegin()), file.size());
 			}
 
+			std::vector<std::string> _watchlist;
+
+			if(watchlist != i.MemberEnd()) {
+				if(!watchlist->value.IsArray()) [[unlikely]] {
+					flog::write(util::format("\"watchlist\" of '%s' is not an array.", _name.c_str()));
+
+					return EXIT_FAILURE;
+				}
+
+				for(const auto & j: watchlist->value.GetArray()) {
+					if(!j.IsString()) [[unlikely]] {
+						flog::write(util::format("\"watchlist\" of '%s' contains a non-string.", _name.c_str()));
+
+						return EXIT_FAILURE;
+					}
+
+					std::string query{j.GetString(), j.GetStringLength()};
+
+					if(utf8::unchecked::distance(query.begin(), query.end()) < std::max(config::min_search_size, 1)) [[unlikely]] {
+						flog::write(util::format("Watchlist query '%s' is too short (LOL).", query.c_str()), flog::Level::warning);
+
+						continue;
+					}
+
+					if(std::find(_watchlist.begin(), _watchlist.end(), query) == _watchlist.end()) {
+						_watchlist.emplace_back(std::move(query));
+					}
+				}
+			}
+
 			archives.emplace_back(_archive{
 				.archive = archive{cache_dir+util::path_separator()+_name+util::path_separator()+"archive.json"}
 				, .path = _path
 				, .icon = std::move(_icon)
 				, .name = _name
+				, .watchlist = std::move(_watchlist)
+				, .words = {}
+				, .suggest = {}
+				, .trends = {}
 			});
 		}
 
@@ -250,37 +305,86 @@ config.example.json:
 			subs
 			, infos
 		;
+		std::vector<archive::source::stamp>
+			subs_stamps // Per subs, from stat. Hashes get filled in once they're read.
+			, info_stamps
+		;
+		bool stamped{false}; // Whether archive.json needs storing even if there's nothing to ingest.
+		std::map<std::pair<std::uint64_t, std::uint64_t>, std::string> relink; // (info hash, subs hash) -> id, of sources whose files moved (or changed). If the contents turn out to be the same, there's no point in ingesting them again.
+		std::unordered_set<std::string> present; // Every file in archive.path. Sources whose files aren't among them (and don't get relinked) are gone.
+
+		{ // Sources whose *.info.json and *.json3 are both still where they were, with the same size and mtime, are skipped without reading anything. Everything else gets (re-)ingested, see relink below for the ones that didn't actually change.
+			struct entry {
+				std::string path;
+				std::string filename;
+				archive::source::stamp stamp;
+			};
+
+			std::vector<entry> entries;
+			std::unordered_map<std::string_view, std::size_t> known; // info/subs -> source.
+			std::vector<unsigned char> unchanged(archive.archive.size(), 0); // Per source, 2 means both files are unchanged.
+
+			for(std::error_code error_code; auto && i: std::filesystem::/*recursive_*/directory_iterator(archive.path)) {
+				if(!i.is_regular_file(error_code) || error_code) {
+					continue;
+				}
 
-		for(std::error_code error_code; auto && i: std::filesystem::/*recursive_*/directory_iterator(archive.path)) {
-			if(!i.is_regular_file(error_code) || error_code) {
-				continue;
+				const auto size{i.file_size(error_code)};
+				const auto mtime{i.last_write_time(error_code)};
+
+				if(error_code) [[unlikely]] {
+					continue;
+				}
+
+				present.emplace(util::from_u8string(i.path().u8string()));
+				entries.emplace_back(entry{
+					.path = util::from_u8string(i.path().u8string())
+					, .filename = util::from_u8string(i.path().filename().u8string())
+					, .stamp = {.size = size, .mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count()), .hash = 0}
+				});
 			}
 
-			const auto path{util::from_u8string(i.path().u8string())};
-			const auto filename{util::from_u8string(i.path().filename().u8string())};
+			known.reserve(2*archive.archive.size());
+			for(std::size_t i{0}; const auto & source: archive.archive) {
+				known.emplace(source.info, i);
+				known.emplace(source.subs, i);
+				++i;
+			}
 
-			if(filename.ends_with(".json3")) {
-				if(std::find_if(
-					archive.archive.begin()
-					, archive.archive.end()
-					, [&path](const auto & x) {return x.subs == path;}
-				) == archive.archive.end()) {
-					subs.emplace_back(path);
-				} else {
-					flog::write(util::format("Duplicate subs '%s'.", filename.c_str()), flog::Level::debug);
-				}
-			} else if(filename.ends_with(".info.json")) {
-				if(std::find_if(
-					archive.archive.begin()
-					, archive.archive.end()
-					, [&path](const auto & x) {return x.info == path;}
-				) == archive.archive.end()) {
-					infos.emplace_back(path);
+			for(const auto & i: entries) {
+				if(const auto j{known.find(i.path)}; j != known.end()) {
+					auto & source{archive.archive[j->second]};
+					auto & stamp{i.path == source.subs ? source.stamps.subs : source.stamps.info};
+
+					if(stamp.empty()) { // Archives from before stamps were a thing. Same path is all we had to go on back then, so that's what it's going to be one last time.
+						stamp = i.stamp;
+						stamped = true;
+					}
+
+					if(stamp.size == i.stamp.size && stamp.mtime == i.stamp.mtime) [[likely]] {
+						++unchanged[j->second];
+					}
+				}
+			}
+
+			for(std::size_t i{0}; const auto & source: archive.archive) {
+				if(unchanged[i++] < 2 && source.stamps.info.hash != 0 && source.stamps.subs.hash != 0) {
+					relink.emplace(std::pair{source.stamps.info.hash, source.stamps.subs.hash}, source.id);
+				}
+			}
+
+			for(auto & i: entries) {
+				if(const auto j{known.find(i.path)}; j != known.end() && unchanged[j->second] == 2) [[likely]] {
+					flog::write(util::format("Unchanged '%s'.", i.filename.c_str()), flog::Level::debug);
+				} else if(i.filename.ends_with(".json3")) {
+					subs.emplace_back(std::move(i.path));
+					subs_stamps.emplace_back(i.stamp);
+				} else if(i.filename.ends_with(".info.json")) {
+					infos.emplace_back(std::move(i.path));
+					info_stamps.emplace_back(i.stamp);
 				} else {
-					flog::write(util::format("Duplicate info '%s'.", filename.c_str()), flog::Level::debug);
+					flog::write(util::format("Unknown file type '%s'.", i.filename.c_str()), flog::Level::debug);
 				}
-			} else {
-				flog::write(util::format("Unknown file type '%s'.", filename.c_str()), flog::Level::debug);
 			}
 		}
 
@@ -316,76 +420,537 @@ config.example.json:
 			});
 		}
 
-		std::mutex mutex;
-		std::vector<std::thread> threads;
-		const std::size_t threads_size{std::thread::hardware_concurrency()};
-
-		threads.reserve(threads_size);
-		for(
-			std::size_t i{0}, size{(_queue.size()+(threads_size-1))/threads_size}
-			; i < threads_size
-			; ++i
-		) {
-			const auto
-				begin{i*size}
-				, end{std::min((i+1)*size, _queue.size())}
+		std::vector<std::string> appended; // ids of the sources we're about to add, for the watchlist.
+		std::vector<std::string> written; // Files ingestion has written, which get fsync'd all at once (rather than one by one, as they get written) before archive.json points to them.
+		std::vector<std::string> reingested; // ids of sources replaced by a newer version of themselves, which doesn't change archive.archive.size() (i.e. the "version" of everything cached).
+		std::size_t dropped{0}; // Sources whose files are gone. Might not change archive.archive.size() either, if as many new ones got ingested.
+		std::vector<std::string> dropped_paths; // Their .text/.events/.words, which archive.json on disk still points to unless it gets stored.
+
+		if(!_queue.empty()) { // read (I/O) -> parse/normalize (CPU) -> write (I/O), with bounded queues in between so that I/O and CPU overlap, and nobody runs too far ahead (or out of memory).
+			struct read {
+				std::size_t i; // Into _queue.
+				std::string info; // *.info.json
+				std::string subs; // *.json3
+			};
+
+			struct parsed {
+				archive::source source;
+				std::string events; // *.events
+				bool relink{false}; // Same contents as an existing source (with the same id), only its paths and stamps need updating.
+			};
+
+			struct stage {
+				std::size_t threads;
+				std::atomic<std::chrono::steady_clock::rep> busy{0}; // Total (across all threads), not counting waiting on queues.
+			};
+
+			const auto t{std::chrono::steady_clock::now()};
+			util::queue<read> reads{config::ingest_queue_size};
+			util::queue<parsed> parses{config::ingest_queue_size};
+			stage
+				read_stage{.threads = std::min<std::size_t>(config::ingest_readers, _queue.size())}
+				, parse_stage{.threads = std::max(1u, std::thread::hardware_concurrency())}
+				, write_stage{.threads = 1}
 			;
+			std::atomic<std::size_t> next{0}, readers{read_stage.threads}, parsers{parse_stage.threads};
+			std::size_t relinked{0};
+			std::unordered_set<std::string> ids; // Already in the archive, i.e. about to be re-ingested if they turn up again.
 
-			threads.emplace_back([&, begin, end] {
-				for(std::size_t i{begin}; i < end; ++i) {
-					auto info{util::read<std::string>(infos[_queue[i].info])};
-					rapidjson::Document _info;
-					archive::source source;
+			for(const auto & i: archive.archive) {
+				ids.emplace(i.id);
+			}
+			std::vector<std::thread> threads;
+			const auto busy{[](stage & stage, const auto t) {
+				stage.busy.fetch_add((std::chrono::steady_clock::now()-t).count(), std::memory_order_relaxed);
+			}};
+
+			threads.reserve(read_stage.threads+parse_stage.threads);
+			for(std::size_t i{0}; i < read_stage.threads; ++i) {
+				threads.emplace_back([&] {
+					std::vector<std::string> paths; // *.info.json, *.json3, *.info.json, ...
+					bool open{true}; // Until reads gets closed on us.
+
+					for(std::size_t i; open && (i = next.fetch_add(config::ingest_read_size, std::memory_order_relaxed)) < _queue.size();) {
+						const auto t{std::chrono::steady_clock::now()};
+						const auto end{std::min<std::size_t>(i+config::ingest_read_size, _queue.size())};
+
+						paths.clear();
+						for(auto j{i}; j < end; ++j) {
+							paths.emplace_back(infos[_queue[j].info]);
+							paths.emplace_back(subs[_queue[j].subs]);
+						}
 
-					_info.ParseInsitu(info.data());
+						auto files{io::read<std::string>(paths)};
 
-					if(
-						!_info.IsObject()
-						|| !source.load(_info.GetObject())
-					) {
-						flog::write(util::format("Unable to parse '%s'.", infos[_queue[i].info].c_str()), flog::Level::warning);
+						busy(read_stage, t);
 
-						continue;
+						for(auto j{i}; open && j < end; ++j) {
+							auto & info{files[(j-i)*2]};
+							auto & _subs{files[(j-i)*2+1]};
+
+							if(!reads.push(read{
+								.i = j
+								, .info = info ? std::move(*info) : std::string{}
+								, .subs = _subs ? std::move(*_subs) : std::string{}
+							})) [[unlikely]] {
+								open = false;
+							}
+						}
+					}
+
+					if(readers.fetch_sub(1) == 1) { // Last one out.
+						reads.close();
+					}
+				});
+			}
+			for(std::size_t i{0}; i < parse_stage.threads; ++i) {
+				threads.emplace_back([&] {
+					while(auto _read{reads.pop()}) {
+						const auto t{std::chrono::steady_clock::now()};
+						const auto i{_read->i};
+						rapidjson::Document _info;
+						parsed _parsed;
+						auto & source{_parsed.source};
+						const decltype(source.stamps) stamps{ // Before ParseInsitu() gets its hands on them.
+							.info = {.size = info_stamps[_queue[i].info].size, .mtime = info_stamps[_queue[i].info].mtime, .hash = util::xxh64(_read->info)}
+							, .subs = {.size = subs_stamps[_queue[i].subs].size, .mtime = subs_stamps[_queue[i].subs].mtime, .hash = util::xxh64(_read->subs)}
+						};
+
+						if(const auto j{relink.find({stamps.info.hash, stamps.subs.hash})}; j != relink.end()) {
+							_parsed.relink = true;
+							source.id = j->second;
+							source.info = infos[_queue[i].info];
+							source.subs = subs[_queue[i].subs];
+							source.stamps = stamps;
+
+							busy(parse_stage, t);
+
+							if(!parses.push(std::move(_parsed))) [[unlikely]] {
+								break;
+							}
+
+							continue;
+						}
+
+						_info.ParseInsitu(_read->info.data());
+
+						if(
+							!_info.IsObject()
+							|| !source.load(_info.GetObject())
+						) {
+							flog::write(util::format("Unable to parse '%s'.", infos[_queue[i].info].c_str()), flog::Level::warning);
+
+							busy(parse_stage, t);
+
+							continue;
+						}
+
+						flog::write(util::format("Generating text/timestamps for '%s'...", subs[_queue[i].subs].c_str()), flog::Level::info);
+
+						if(std::vector<events::event> _events; sub::json3(&source.text.data, &_events, &source.words.data, &_read->subs)) {
+							const auto name{[&] { // A re-ingested source gets files of its own, rather than overwriting the ones the current archive.json points to: the old ones have to stay intact until the new archive.json replaces it (after which nothing points to them, and they get collected as garbage).
+								if(!ids.contains(source.id)) [[likely]] {
+									return source.id;
+								}
+
+								const std::array hashes{stamps.info.hash, stamps.subs.hash};
+
+								return source.id+util::format(".%016llx", static_cast<unsigned long long>(util::xxh64(std::string_view{reinterpret_cast<const char *>(hashes.data()), sizeof(hashes)})));
+							}()};
+
+							source.info = infos[_queue[i].info];
+							source.subs = subs[_queue[i].subs];
+							source.text.path = archive_path+util::path_separator()+(name+".text");
+							source.events.path = archive_path+util::path_separator()+(name+".events");
+							source.events.data = events{_events};
+							source.events.data.store(&_parsed.events);
+							source.words.path = archive_path+util::path_separator()+(name+".words");
+							source.stamps = stamps;
+							source.checksums = {
+								.text = util::xxh64(std::string_view{source.text.data})
+								, .events = util::xxh64(_parsed.events)
+								, .words = util::xxh64(std::string_view{reinterpret_cast<const char *>(source.words.data.data()), source.words.data.size()*sizeof(std::uint32_t)})
+							};
+
+							busy(parse_stage, t);
+
+							if(!parses.push(std::move(_parsed))) [[unlikely]] {
+								break;
+							}
+						} else {
+							flog::write(util::format("Unable to generate text/timestamps for '%s'.", subs[_queue[i].subs].c_str()), flog::Level::warning);
+
+							busy(parse_stage, t);
+						}
 					}
 
-					flog::write(util::format("Generating text/timestamps for '%s'...", subs[_queue[i].subs].c_str()), flog::Level::info);
+					if(parsers.fetch_sub(1) == 1) {
+						parses.close();
+					}
+				});
+			}
 
-					if(sub::json3(&source.text.data, &source.timestamps.data, subs[_queue[i].subs])) {
-						source.info = std::move(infos[_queue[i].info]);
-						source.subs = std::move(subs[_queue[i].subs]);
-						source.text.path = archive_path+util::path_separator()+(source.id+".text");
-						source.timestamps.path = archive_path+util::path_separator()+(source.id+".timestamps");
+			{ // Writer, right here. Batches, so that the archive gets re-sorted (and re-indexed) once per batch rather than once per source.
+				std::vector<archive::source> batch;
+				std::vector<std::string> replaced; // ids of sources in batch that are already in the archive (updated subs, most likely), whose old versions have to go.
 
-						util::write(source.text.path, source.text.data);
-						util::write(source.timestamps.path, source.timestamps.data);
+				batch.reserve(config::ingest_batch_size);
+				for(;;) {
+					auto _parsed{parses.pop()};
+					const auto t{std::chrono::steady_clock::now()};
 
-						std::lock_guard<std::mutex> lock_guard(mutex);
+					if(_parsed && _parsed->relink) {
+						const auto & source{_parsed->source};
 
-						archive.archive.append(std::move(source));
-					} else {
-						flog::write(util::format("Unable to generate text/timestamps for '%s'.", subs[_queue[i].subs].c_str()), flog::Level::warning);
+						if(const auto i{std::find_if(archive.archive.begin(), archive.archive.end(), [&](const auto & x) {return x.id == source.id;})}; i != archive.archive.end()) [[likely]] {
+							flog::write(util::format("Unchanged '%s', only moved (or touched).", source.subs.c_str()), flog::Level::info);
+
+							i->info = source.info;
+							i->subs = source.subs;
+							i->stamps = source.stamps;
+							++relinked;
+						}
+					} else if(_parsed) {
+						const auto & source{_parsed->source};
+
+						if(
+							!util::write(source.text.path, source.text.data)
+							|| !util::write(source.events.path, _parsed->events)
+							|| !util::write(source.words.path, source.words.data)
+						) [[unlikely]] {
+							flog::write(util::format("Unable to write text/timestamps for '%s'.", source.subs.c_str()), flog::Level::warning); // Gets another shot next time, since it's not in the archive.
+
+							busy(write_stage, t);
+
+							continue;
+						}
+
+						written.emplace_back(source.text.path);
+						written.emplace_back(source.events.path);
+						written.emplace_back(source.words.path);
+
+						if(ids.contains(source.id)) {
+							flog::write(util::format("Re-ingested '%s'.", source.subs.c_str()), flog::Level::info);
+
+							replaced.emplace_back(source.id);
+							reingested.emplace_back(source.id);
+						}
+
+						appended.emplace_back(source.id);
+						batch.emplace_back(std::move(_parsed->source));
+					}
+
+					if(!batch.empty() && (!_parsed || batch.size() >= config::ingest_batch_size)) {
+						if(!replaced.empty()) {
+							archive.archive.erase_if([&replaced](const auto & x) {return std::find(replaced.begin(), replaced.end(), x.id) != replaced.end();});
+							replaced.clear();
+						}
+
+						archive.archive.append(std::move(batch));
+						batch.clear();
+					}
+
+					busy(write_stage, t);
+
+					if(!_parsed) {
+						break;
 					}
 				}
-			});
+			}
+
+			for(auto & i: threads) {
+				i.join();
+			}
+
+			const auto wall{static_cast<double>((std::chrono::steady_clock::now()-t).count())};
+			const auto ms{[](const auto duration) {return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count())/double{1'000'000};}};
+			const auto utilization{[&](const stage & stage) {return 100.0*static_cast<double>(stage.busy.load())/(wall*static_cast<double>(stage.threads));}};
+
+			flog::write( // Whichever stage is (close to) 100% busy is the bottleneck. Time spent blocked on a full queue means the stage after it can't keep up, starved means the one before it can't.
+				util::format(
+					"Ingested %zu/%zu sources (%zu unchanged) into '%s' in %.2fms. read: %zu thread(s), %.0f%% busy, %.2fms blocked. parse: %zu thread(s), %.0f%% busy, %.2fms starved, %.2fms blocked. write: %.0f%% busy, %.2fms starved."
+					, appended.size()
+					, _queue.size()
+					, relinked
+					, archive.name.c_str()
+					, ms(std::chrono::steady_clock::now()-t)
+					, read_stage.threads
+					, utilization(read_stage)
+					, ms(reads.push_wait())
+					, parse_stage.threads
+					, utilization(parse_stage)
+					, ms(reads.pop_wait())
+					, ms(parses.push_wait())
+					, utilization(write_stage)
+					, ms(parses.pop_wait())
+				)
+				, flog::Level::info
+			);
 		}
 
-		for(auto & i: threads) {
-			i.join();
+		{ // Only now that the queue had a chance to relink them, since a source whose files are missing might've just been moved. Doesn't store archive.json by itself: a missing (or unmounted) archive.path would take everything with it otherwise.
+			const auto size{archive.archive.size()};
+
+			archive.archive.erase_if([&present, &dropped_paths](const auto & x) {
+				if(present.contains(x.info) && present.contains(x.subs)) [[likely]] {
+					return false;
+				}
+
+				dropped_paths.insert(dropped_paths.end(), {x.text.path, x.events.path, x.words.path});
+
+				return true;
+			});
+			dropped = size-archive.archive.size();
+
+			if(dropped > 0) {
+				flog::write(util::format("Dropped %zu source(s) whose files are gone from '%s'.", dropped, archive.path.c_str()), flog::Level::warning);
+			}
 		}
 
-		if(!_queue.empty()) {
-			util::file file{(archive_path+util::path_separator()+"archive.json").c_str(), "w"};
+		if(!_queue.empty() || stamped) { // Data first, then archive.json (atomically), so that a crash at any point leaves either the old archive or the new one, never a mix. Anything that still slips through gets caught by source::checksums on load.
+			const auto path{archive_path+util::path_separator()+"archive.json"};
+
+			if(!written.empty()) {
+				const auto t{std::chrono::steady_clock::now()};
 
-			if(!file) {
-				flog::write(util::format("Unable to open '%s'.", (archive_path+util::path_separator()+"archive.json").c_str()));
+				if(!io::sync(written) || !util::sync(archive_path)) [[unlikely]] {
+					flog::write(util::format("Unable to sync '%s'.", archive_path.c_str()), flog::Level::warning);
+				}
+
+				flog::write(
+					util::format(
+						"Synced %zu file(s) in %.2fms."
+						, written.size()
+						, static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-t).count())/double{1'000'000}
+					)
+					, flog::Level::debug
+				);
+			}
+
+			if(!util::write_atomic(path, [&](std::FILE * file) {return archive.archive.store(file);})) [[unlikely]] {
+				flog::write(util::format("Unable to write '%s'.", path.c_str()));
 
 				return EXIT_FAILURE;
 			}
+		}
+
+		if(!archive.archive.empty()) { // Garbage collection of whatever no source points to anymore (converted *.timestamps, sources that couldn't be loaded, ...). An empty archive is more likely to be a broken archive.json than an actually empty one, so that doesn't get to delete anything. Neither do dropped sources, which the archive.json on disk might still list.
+			std::unordered_set<std::string> referenced; // File names, in case archive_path got moved around.
+			const auto filename{[](const std::string & path) {return util::from_u8string(std::filesystem::path{util::to_char8_t(path)}.filename().u8string());}};
+			std::size_t removed{0};
+
+			for(const auto & i: archive.archive) {
+				referenced.emplace(filename(i.text.path));
+				referenced.emplace(filename(i.events.path));
+				referenced.emplace(filename(i.words.path));
+			}
+			for(const auto & i: dropped_paths) {
+				referenced.emplace(filename(i));
+			}
+
+			for(std::error_code error_code; auto && i: std::filesystem::directory_iterator(util::to_char8_t(archive_path), error_code)) {
+				if(!i.is_regular_file(error_code) || error_code) {
+					continue;
+				}
+
+				const auto _filename{util::from_u8string(i.path().filename().u8string())};
+
+				if(
+					(_filename.ends_with(".text") || _filename.ends_with(".events") || _filename.ends_with(".words") || _filename.ends_with(".timestamps"))
+					&& !referenced.contains(_filename)
+				) {
+					if(std::filesystem::remove(i.path(), error_code) && !error_code) [[likely]] {
+						flog::write(util::format("Removed orphaned '%s'.", _filename.c_str()), flog::Level::debug);
+
+						++removed;
+					}
+				}
+			}
+
+			if(removed > 0) {
+				flog::write(util::format("Removed %zu orphaned file(s) from '%s'.", removed, archive_path.c_str()), flog::Level::info);
+			}
+		}
+
+		if(!archive.watchlist.empty()) { // Queries that already have a log only need to look at what's just been appended, new ones have to go through everything once.
+			const auto watchlist_path{archive_path+util::path_separator()+"watchlist"};
+
+			if(std::error_code error_code; !std::filesystem::is_directory(util::to_char8_t(watchlist_path), error_code) || error_code) {
+				if(!std::filesystem::create_directories(util::to_char8_t(watchlist_path), error_code) || error_code) [[unlikely]] {
+					flog::write(util::format("!create_directories('%s').", watchlist_path.c_str()));
+
+					return EXIT_FAILURE;
+				}
+			}
+
+			const auto time{std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()};
+			std::vector<std::vector<watchlist::hit> > hits(archive.watchlist.size());
+			std::vector<bool> exists(archive.watchlist.size());
+
+			for(std::size_t i{0}; i < archive.watchlist.size(); ++i) {
+				exists[i] = util::file_exists(watchlist::path(watchlist_path, archive.watchlist[i]));
+			}
+
+			std::sort(appended.begin(), appended.end());
+
+			for(const auto all: {false, true}) {
+				std::vector<std::string_view> queries;
+				std::vector<std::size_t> index; // queries -> archive.watchlist.
+
+				for(std::size_t i{0}; i < archive.watchlist.size(); ++i) {
+					if(exists[i] != all) {
+						queries.emplace_back(archive.watchlist[i]);
+						index.emplace_back(i);
+					}
+				}
+
+				if(queries.empty() || (!all && appended.empty())) {
+					continue;
+				}
+
+				flog::write(util::format("Searching for %zu watchlist queries in %zu sources...", queries.size(), all ? archive.archive.size() : appended.size()), flog::Level::info);
+
+				const query::phrases _queries{queries}; // Literals only (even with USE_REGEX), since these can run over the entire archive.
+
+				for(const auto & i: archive.archive) {
+					if(!all && !std::binary_search(appended.begin(), appended.end(), i.id)) {
+						continue;
+					}
+
+					archive.archive.find(i, _queries, [&](
+						const std::string_view
+						, const std::size_t offset
+						, const std::size_t
+						, const config::timestamp_type timestamp
+						, const archive::source & source
+						, const std::size_t query
+					) {
+						hits[index[query]].emplace_back(watchlist::hit{
+							.time = time
+							, .id = source.id
+							, .offset = offset
+							, .timestamp = timestamp
+						});
+					});
+				}
+			}
+
+			for(std::size_t i{0}; i < archive.watchlist.size(); ++i) {
+				const auto rank{[](const watchlist::hit & x) {return x.offset == watchlist::superseded ? 0 : x.offset+1;}}; // Superseding records go right before the new hits of their source.
+				const auto size{hits[i].size()};
+
+				if(exists[i]) { // Re-ingested sources already had their hits logged, for a text that's gone now. Their new hits (if any) are in hits[i] by now, since they're in appended too.
+					for(const auto & j: reingested) {
+						hits[i].emplace_back(watchlist::hit{
+							.time = time
+							, .id = j
+							, .offset = watchlist::superseded
+							, .timestamp = 0
+						});
+					}
+				}
+
+				std::sort(
+					hits[i].begin()
+					, hits[i].end()
+					, [&rank](const auto & lhs, const auto & rhs) {return lhs.id < rhs.id || (lhs.id == rhs.id && rank(lhs) < rank(rhs));}
+				);
+
+				if(!watchlist::append(watchlist::path(watchlist_path, archive.watchlist[i]), archive.watchlist[i], hits[i])) [[unlikely]] {
+					flog::write(util::format("Unable to update the watchlist log of '%s'.", archive.watchlist[i].c_str()));
+				} else if(size > 0) {
+					flog::write(util::format("'%s': %zu new hits.", archive.watchlist[i].c_str(), size), flog::Level::info);
+				}
+			}
+		}
+
+		{
+			const auto t{std::chrono::high_resolution_clock::now()};
+
+			archive.words = word_index{archive.archive}; // In memory only, it's quick enough to rebuild and this way there's nothing to keep in sync.
+
+			flog::write(
+				util::format(
+					"Indexed '%s' (%zu terms) in %.2fms."
+					, archive.name.c_str()
+					, archive.words.size()
+					, static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()-t).count())/double{1'000'000}
+				)
+				, flog::Level::info
+			);
+		}
+
+		if(!reingested.empty() || dropped > 0) { // Would look up to date otherwise.
+			for(const auto i: {"suggest.dict", "trends.json"}) {
+				std::error_code error_code;
+
+				std::filesystem::remove(util::to_char8_t(archive_path+util::path_separator()+i), error_code);
+			}
+		}
+
+		{
+			const auto suggest_path{archive_path+util::path_separator()+"suggest.dict"};
+
+			archive.suggest = suggest{suggest_path, archive.archive.size()};
+
+			if(!archive.suggest) { // Missing or stale.
+				const auto t{std::chrono::high_resolution_clock::now()};
+
+				if(suggest::build(archive.archive, archive.words, suggest_path, archive.archive.size())) [[likely]] {
+					archive.suggest = suggest{suggest_path, archive.archive.size()};
+
+					flog::write(
+						util::format(
+							"Built '%s' in %.2fms."
+							, suggest_path.c_str()
+							, static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()-t).count())/double{1'000'000}
+						)
+						, flog::Level::info
+					);
+				} else {
+					flog::write(util::format("Unable to build '%s'.", suggest_path.c_str()), flog::Level::warning);
+				}
+			}
+		}
 
-			archive.archive.store(static_cast<std::FILE *>(file));
+		{
+			auto trends{util::read<std::string>(archive_path+util::path_separator()+"trends.json")};
+
+			if(trends.starts_with(util::format("{\"version\":%zu,", archive.archive.size()))) {
+				archive.trends = std::make_shared<const std::string>(std::move(trends));
+			} else {
+				trends_stale.emplace_back(static_cast<std::size_t>(&archive-archives.data()));
+			}
 		}
 	}
 
+	std::thread trends_thread{[&] { // Takes a while (it reads every n-gram of every source, twice), so the server doesn't wait for it.
+		for(const auto i: trends_stale) {
+			auto & archive{archives[i]};
+			const auto t{std::chrono::high_resolution_clock::now()};
+			auto trends{std::make_shared<const std::string>(trends::find(archive.archive, archive.archive.size()))};
+			const auto path{cache_dir+util::path_separator()+archive.name+util::path_separator()+"trends.json"};
+
+			if(!util::write_atomic(path, [&](std::FILE * file) {return std::fwrite(trends->data(), sizeof(char), trends->size(), file) == trends->size();})) [[unlikely]] {
+				flog::write(util::format("Unable to write '%s'.", path.c_str()), flog::Level::warning); // Still served, just computed again next time.
+			}
+
+			flog::write(
+				util::format(
+					"Found trends for '%s' in %.2fms."
+					, archive.name.c_str()
+					, static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()-t).count())/double{1'000'000}
+				)
+				, flog::Level::info
+			);
+
+			std::lock_guard lock{trends_mutex};
+
+			archive.trends = std::move(trends);
+		}
+	}};
+
+	util::pool search_pool{std::max(1u, std::thread::hardware_concurrency())}; // Shared by every cross-archive search (POST({"archives": [...], ...})), so that they don't each spin up a thread per archive.
 	httplib::Server server;
 
 #ifndef NDEBUG
@@ -447,14 +1012,15 @@ config.example.json:
 			]
 			*/
 
-			std::string json{'['};
+			auto & json{util::thread_buffer()};
 
+			json += '[';
 			for(char separator{' '}; const auto & i: archives) {
 				util::strcat(
 					&json
 					, separator
 					, "{\"name\":\""
-					, util::json_escape(i.name)
+					, util::json_escaped{i.name}
 					, "\",\"icon\":\""
 					, i.icon
 					, "\"}"
@@ -464,7 +1030,7 @@ config.example.json:
 			}
 			json += ']';
 
-			response.set_content(json, "application/json");
+			response.set_content(json.data(), json.size(), "application/json");
 
 			return;
 		}
@@ -507,145 +1073,1039 @@ config.example.json:
 				return;
 			}
 
-			std::string json{"{\"archive\":"};
+			auto & json{util::thread_buffer()};
+
+			json.reserve(archive->archive.size()*128);
 
+			json += "{\"archive\":";
 			for(char separator{'['}; const auto & i: archive->archive) {
 				util::strcat(
 					&json
 					, separator
 					, "{\"i\":\""
-					, i.id
+					, util::json_escaped{i.id}
 					, "\""
 					, ",\"u\":"
-					, std::to_string(i.upload_date)
+					, i.upload_date
 					, ",\"t\":\""
-					, util::json_escape(i.title) // escape()'ing the strings here isn't ideal but this avoids any "unintended consequences" (and doesn't *really* matter).
+					, util::json_escaped{i.title} // escape()'ing the strings here isn't ideal but this avoids any "unintended consequences" (and doesn't *really* matter).
 					, "\"}"
 				);
 
 				separator = ',';
 			}
+			if(archive->archive.empty()) {
+				json += '[';
+			}
 			util::strcat(
 				&json
 				, "],\"version\":"
-				, std::to_string(archive->archive.size()) // TODO: Cache the entire JSON string and version (which should be something more reliable than "size").
+				, archive->archive.size() // TODO: Cache the entire JSON string and version (which should be something more reliable than "size").
 				, '}'
 			);
 
-			response.set_content(json, "application/json");
+			response.set_content(json.data(), json.size(), "application/json");
 
 			return;
 		}
 
-		const auto t{std::chrono::high_resolution_clock::now()};
-
-		std::string substr;
-		std::remove_cv_t<decltype(config::substr_size_max)> substr_size{0};
-
-		if(
-			!document.HasMember("archive")
-			|| !document.HasMember("substr")
-		) [[unlikely]] {
-			flog::write(util::format("(%s:%i) Invalid request.", request.remote_addr.c_str(), request.remote_port));
+		if(const auto _suggest{document.FindMember("suggest")}; _suggest != document.MemberEnd()) {
+			/*
+			[
+				{
+					"w": String   // Word (or two)
+					, "f": Number // How many times it's been said
+				}
+			]
+			*/
 
-			return;
-		}
+			const auto prefix{document.FindMember("prefix")};
 
-		auto archive{archives.end()};
+			if(
+				!_suggest->value.IsString()
+				|| prefix == document.MemberEnd()
+				|| !prefix->value.IsString()
+				|| prefix->value.GetStringLength() == 0
+			) [[unlikely]] {
+				flog::write(util::format("(%s:%i) Invalid \"suggest\".", request.remote_addr.c_str(), request.remote_port));
 
-		{
-			const auto _archive{document.FindMember("archive")};
+				return;
+			}
 
-			archive = std::find_if(
+			const auto archive{std::find_if(
 				archives.begin()
 				, archives.end()
-				, [name{std::string_view{_archive->value.GetString(), _archive->value.GetStringLength()}}](const auto & x) {
+				, [name{std::string_view{_suggest->value.GetString(), _suggest->value.GetStringLength()}}](const auto & x) {
 					return x.name == name;
 				}
-			);
+			)};
 
-			if(archive == archives.end()) [[unlikely]] {
-				flog::write(util::format("(%s:%i) Unable to find archive '%s'.", request.remote_addr.c_str(), request.remote_port, _archive->value.GetString()));
+			if(archive == archives.end()) {
+				flog::write(util::format("(%s:%i) archive == archives.end().", request.remote_addr.c_str(), request.remote_port));
 
 				return;
 			}
-		}
 
-		{
-			const auto _substr{document.FindMember("substr")};
+			std::size_t n{config::suggest_max};
 
-			substr = std::string{_substr->value.GetString(), _substr->value.GetStringLength()};
+			if(const auto _n{document.FindMember("n")}; _n != document.MemberEnd() && _n->value.IsUint()) {
+				n = std::min<std::size_t>(_n->value.GetUint(), config::suggest_max);
+			}
 
-			if constexpr(config::min_search_size > 0) {
-				if(utf8::unchecked::distance(substr.begin(), substr.end()) < config::min_search_size) [[unlikely]] {
-					flog::write(util::format("(%s:%i) Search term '%s' is too short (LOL).", request.remote_addr.c_str(), request.remote_port, substr.c_str()));
+			auto & json{util::thread_buffer()};
 
-					response.set_content("{}", "application/json");
+			json += '[';
+			archive->suggest.find(std::string_view{prefix->value.GetString(), prefix->value.GetStringLength()}, n, [&, separator{' '}](const std::string_view term, const std::uint32_t frequency) mutable {
+				util::strcat(&json, separator, "{\"w\":\"", util::json_escaped{term}, "\",\"f\":", frequency, '}');
 
-					return;
-				}
-			}
+				separator = ',';
+			});
+			json += ']';
 
-			const auto _substr_size{document.FindMember("substr_size")};
+			response.set_content(json.data(), json.size(), "application/json");
 
-			if(_substr_size != document.MemberEnd()) {
-				substr_size = _substr_size->value.GetInt();
-			}
+			return;
 		}
 
-		substr_size = std::clamp(
-			substr_size
-			, std::max(static_cast<std::remove_cvref_t<decltype(config::substr_size_min)> >(substr.size()), config::substr_size_min)
-			, config::substr_size_max
-		);
+		if(const auto expand{document.FindMember("expand")}; expand != document.MemberEnd()) {
+			/*
+			{
+				"s": String   // Text around the hit at "offset" (and "length"), "radius" code points on each side (or less, at the beginning/end of the source)
+				, "ts": [     // [offset, timestamp] pairs, offset (UTF-16 code units) into "s" at which a subtitle event (starting at timestamp, in milliseconds) begins
+					Number
+				]
+			}
+			*/
 
-		std::size_t count{0};
-		std::vector<std::size_t> counts(archive->archive.size(), 0);
-		std::string json{"{\"search\":["};
-		char separator{' '}; // Has to be a space in case we get 0 results.
-
-		struct page {
-			std::ptrdiff_t archive;
-			std::size_t begin;
-			std::size_t end;
-		};
+			const auto source{document.FindMember("source")};
+			const auto offset{document.FindMember("offset")};
+			const auto length{document.FindMember("length")}; // Of the hit at offset, UTF-16 code units (i.e. the first "h" length of a search result). Optional.
+			const auto radius{document.FindMember("radius")};
 
-		std::vector<std::size_t> archive_pages(archive->archive.size(), 0);
-		std::vector<std::vector<page> > pages{1};
-		std::size_t page_length{0};
-		std::size_t result_index{0};
-
-		archive->archive.find(
-			substr
-#ifdef USE_REGEX
-			, [&](
-#else // !USE_REGEX
-			, [&, result_length{utf8::unchecked::distance(substr.begin(), substr.end())}](
-#endif // USE_REGEX
-				const std::string_view text
-				, const std::size_t result_offset
-				, [[maybe_unused]] const std::size_t result_size
-				, const config::timestamp_type timestamp
-				, const archive::source & source
-			) {
-#ifdef USE_REGEX
-				if(result_size > config::substr_size_max) { // FIXME: Using *_size is incorrect but saves cycles.
-					return;
-				}
+			if(
+				!expand->value.IsString()
+				|| source == document.MemberEnd()
+				|| !source->value.IsUint()
+				|| offset == document.MemberEnd()
+				|| !offset->value.IsUint64()
+			) [[unlikely]] {
+				flog::write(util::format("(%s:%i) Invalid \"expand\".", request.remote_addr.c_str(), request.remote_port));
 
-				const auto result_length{utf8::unchecked::distance(text.begin()+result_offset, (text.begin()+result_offset)+result_size)};
-#endif // USE_REGEX
+				return;
+			}
 
-				/*
-				{
-					"search": [
-						{
-							"s": String   // substr
-							, "t": Number // timestamp
+			const auto archive{std::find_if(
+				archives.begin()
+				, archives.end()
+				, [name{std::string_view{expand->value.GetString(), expand->value.GetStringLength()}}](const auto & x) {
+					return x.name == name;
+				}
+			)};
+
+			if(
+				archive == archives.end()
+				|| source->value.GetUint() >= archive->archive.size()
+			) {
+				flog::write(util::format("(%s:%i) archive == archives.end() || source >= archive.size().", request.remote_addr.c_str(), request.remote_port));
+
+				return;
+			}
+
+			const auto & _source{archive->archive[source->value.GetUint()]};
+			const auto text{std::string_view{_source.text.data}};
+			const auto _radius{radius != document.MemberEnd() && radius->value.IsUint() ? std::min<std::size_t>(radius->value.GetUint(), config::expand_radius_max) : config::expand_radius_max};
+			const auto _length{length != document.MemberEnd() && length->value.IsUint() ? std::min<std::size_t>(length->value.GetUint(), 2*config::substr_size_max) : 0}; // Highlights never leave a snippet.
+			const auto * const text_end{text.data()+text.size()};
+			auto begin{text.data()+std::min<std::size_t>(offset->value.GetUint64(), text.size())};
+
+			while(begin > text.data() && begin < text_end && utf8::internal::is_trail(*begin)) { // Offsets come from the client, so they might not be at a code point boundary (or even in the text).
+				--begin;
+			}
+
+			auto end{begin};
+
+			for(std::size_t i{0}; begin > text.data() && i < _radius; ++i) {
+				utf8::unchecked::prior(begin);
+			}
+			for(std::size_t i{0}; end < text_end && i < _length;) { // The hit itself.
+				i += utf8::unchecked::next(end) > 0xFFFF ? 2 : 1;
+			}
+			for(std::size_t i{0}; end < text_end && i < _radius; ++i) {
+				utf8::unchecked::next(end);
+			}
+
+			const std::string_view window{begin, static_cast<std::size_t>(end-begin)};
+			auto & json{util::thread_buffer()};
+
+			util::strcat(&json, "{\"s\":\"", window, "\",\"ts\":");
+			{
+				const auto * p{window.data()};
+				std::size_t length{0}; // UTF-16 code units, same as the search's "h".
+				char separator{'['};
+
+				archive->archive.timestamps(_source, static_cast<std::size_t>(window.data()-text.data()), static_cast<std::size_t>(window.data()-text.data())+window.size(), [&](const std::size_t offset, const config::timestamp_type timestamp) {
+					for(; p < text.data()+offset; length += utf8::unchecked::next(p) > 0xFFFF ? 2 : 1) {
+					}
+
+					util::strcat(&json, separator, length, ',', timestamp);
+
+					separator = ',';
+				});
+				if(separator == '[') {
+					json += '[';
+				}
+			}
+			json += "]}";
+
+			response.set_content(json.data(), json.size(), "application/json");
+
+			return;
+		}
+
+		if(const auto transcript{document.FindMember("transcript")}; transcript != document.MemberEnd()) {
+			/*
+			{
+				"lines": [
+					{
+						"t": Number   // Timestamp (milliseconds)
+						, "s": String // Whatever was said from "t" until the next line's "t"
+					}
+				]
+				, "more": Boolean // Whether the text got cut short (see config::transcript_size_max)
+			}
+			*/
+
+			const auto source{document.FindMember("source")};
+			const auto from{document.FindMember("from")};
+			const auto to{document.FindMember("to")};
+
+			if(
+				!transcript->value.IsString()
+				|| source == document.MemberEnd()
+				|| !source->value.IsUint()
+				|| from == document.MemberEnd()
+				|| !from->value.IsUint()
+				|| to == document.MemberEnd()
+				|| !to->value.IsUint()
+			) [[unlikely]] {
+				flog::write(util::format("(%s:%i) Invalid \"transcript\".", request.remote_addr.c_str(), request.remote_port));
+
+				return;
+			}
+
+			const auto archive{std::find_if(
+				archives.begin()
+				, archives.end()
+				, [name{std::string_view{transcript->value.GetString(), transcript->value.GetStringLength()}}](const auto & x) {
+					return x.name == name;
+				}
+			)};
+
+			if(
+				archive == archives.end()
+				|| source->value.GetUint() >= archive->archive.size()
+			) {
+				flog::write(util::format("(%s:%i) archive == archives.end() || source >= archive.size().", request.remote_addr.c_str(), request.remote_port));
+
+				return;
+			}
+
+			const auto & _source{archive->archive[source->value.GetUint()]};
+			const auto text{std::string_view{_source.text.data}};
+			const auto word{[&](std::size_t offset) { // Start of the word offset is in, timestamp blocks don't care about words (or code points).
+				for(; offset > 0 && offset < text.size() && text[offset-1] != ' '; --offset) {
+				}
+
+				return offset;
+			}};
+			constexpr auto timestamp_max{std::numeric_limits<config::timestamp_type>::max()};
+			const auto begin{word(archive->archive.seek(_source, static_cast<config::timestamp_type>(std::min<unsigned>(from->value.GetUint(), timestamp_max))))};
+			auto end{to->value.GetUint() >= timestamp_max ? text.size() : word(archive->archive.seek(_source, static_cast<config::timestamp_type>(to->value.GetUint()+1)))};
+			const auto more{end > begin+config::transcript_size_max};
+
+			if(more) {
+				end = word(begin+config::transcript_size_max);
+			}
+
+			auto & json{util::thread_buffer()};
+
+			json += "{\"lines\":[";
+			if(begin < end) {
+				std::size_t line{begin};
+				config::timestamp_type timestamp{0};
+
+				archive->archive.timestamps(_source, begin, end, [&](const std::size_t offset, const config::timestamp_type _timestamp) {
+					if(const auto _offset{word(offset)}; _offset > line) {
+						util::strcat(&json, line > begin ? "," : "", "{\"t\":", timestamp, ",\"s\":\"", text.substr(line, _offset-line), "\"}");
+
+						line = _offset;
+					}
+
+					timestamp = _timestamp;
+				});
+				util::strcat(&json, line > begin ? "," : "", "{\"t\":", timestamp, ",\"s\":\"", text.substr(line, end-line), "\"}");
+			}
+			util::strcat(&json, "],\"more\":", more ? "true" : "false", '}');
+
+			response.set_content(json.data(), json.size(), "application/json");
+
+			return;
+		}
+
+		if(const auto _trends{document.FindMember("trends")}; _trends != document.MemberEnd()) {
+			/*
+			See trends::find(), or {"pending": true} if it's still running.
+			*/
+
+			if(!_trends->value.IsString()) [[unlikely]] {
+				flog::write(util::format("(%s:%i) Invalid \"trends\".", request.remote_addr.c_str(), request.remote_port));
+
+				return;
+			}
+
+			const auto archive{std::find_if(
+				archives.begin()
+				, archives.end()
+				, [name{std::string_view{_trends->value.GetString(), _trends->value.GetStringLength()}}](const auto & x) {
+					return x.name == name;
+				}
+			)};
+
+			if(archive == archives.end()) {
+				flog::write(util::format("(%s:%i) archive == archives.end().", request.remote_addr.c_str(), request.remote_port));
+
+				return;
+			}
+
+			std::shared_ptr<const std::string> trends;
+
+			{
+				std::lock_guard lock{trends_mutex};
+
+				trends = archive->trends;
+			}
+
+			if(trends) [[likely]] {
+				response.set_content(trends->data(), trends->size(), "application/json");
+			} else {
+				response.set_content("{\"pending\":true}", "application/json");
+			}
+
+			return;
+		}
+
+		if(const auto _watchlist{document.FindMember("watchlist")}; _watchlist != document.MemberEnd()) {
+			/*
+			{
+				"time": Number // Server time, pass it as "since" next time to get only the hits found after this request
+				, "watchlist": [
+					{
+						"q": String // Query
+						, "hits": [
+							{
+								"i": String   // id
+								, "o": Number // Offset into the source's text
+								, "t": Number // Timestamp (milliseconds)
+								, "b": Number // When the hit was found (seconds since epoch)
+							}
+							, {            // No "o" or "t": the source got ingested again (its subs changed). Earlier hits of "i" no longer apply, later ones are for its new text.
+								"i": String
+								, "b": Number
+							}
+						]
+					}
+				]
+			}
+			*/
+
+			if(!_watchlist->value.IsString()) [[unlikely]] {
+				flog::write(util::format("(%s:%i) Invalid \"watchlist\".", request.remote_addr.c_str(), request.remote_port));
+
+				return;
+			}
+
+			const auto archive{std::find_if(
+				archives.begin()
+				, archives.end()
+				, [name{std::string_view{_watchlist->value.GetString(), _watchlist->value.GetStringLength()}}](const auto & x) {
+					return x.name == name;
+				}
+			)};
+
+			if(archive == archives.end()) {
+				flog::write(util::format("(%s:%i) archive == archives.end().", request.remote_addr.c_str(), request.remote_port));
+
+				return;
+			}
+
+			std::int64_t since{0};
+
+			if(const auto _since{document.FindMember("since")}; _since != document.MemberEnd() && _since->value.IsInt64()) {
+				since = _since->value.GetInt64();
+			}
+
+			const auto watchlist_path{cache_dir+util::path_separator()+archive->name+util::path_separator()+"watchlist"};
+			auto & json{util::thread_buffer()};
+
+			util::strcat(
+				&json
+				, "{\"time\":"
+				, std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+				, ",\"watchlist\":["
+			);
+			for(char separator{' '}; const auto & i: archive->watchlist) {
+				util::strcat(&json, separator, "{\"q\":\"", util::json_escaped{i}, "\",\"hits\":[");
+				watchlist::read(watchlist::path(watchlist_path, i), i, since, [&, _separator{' '}](const auto & hit) mutable {
+					if(hit.offset == watchlist::superseded) [[unlikely]] {
+						util::strcat(&json, _separator, "{\"i\":\"", util::json_escaped{hit.id}, "\",\"b\":", hit.time, '}');
+
+						_separator = ',';
+
+						return;
+					}
+
+					util::strcat(
+						&json
+						, _separator
+						, "{\"i\":\""
+						, util::json_escaped{hit.id}
+						, "\",\"o\":"
+						, hit.offset
+						, ",\"t\":"
+						, hit.timestamp
+						, ",\"b\":"
+						, hit.time
+						, '}'
+					);
+
+					_separator = ',';
+				});
+				json += "]}";
+
+				separator = ',';
+			}
+			json += "]}";
+
+			response.set_content(json.data(), json.size(), "application/json");
+
+			return;
+		}
+
+		const auto t{std::chrono::high_resolution_clock::now()};
+
+		std::string substr;
+		std::vector<std::string> phrases; // Batch search, in which case substr is only used for logging.
+		std::string session; // Opaque client id, see query::session.
+		bool words{false}; // Whole words (and phrases of them) only, see word_index.
+		std::size_t rank{0}; // Top-k sources (by BM25) instead of everything, see word_index::rank().
+		std::int64_t
+			from{std::numeric_limits<std::int64_t>::min()} // upload_date range (seconds since epoch, inclusive).
+			, to{std::numeric_limits<std::int64_t>::max()}
+		;
+		std::remove_cv_t<decltype(config::substr_size_max)> substr_size{config::substr_size_default};
+		bool binary{false};
+
+		if(
+			(!document.HasMember("archive") && !document.HasMember("archives"))
+			|| (!document.HasMember("substr") && !document.HasMember("phrases"))
+		) [[unlikely]] {
+			flog::write(util::format("(%s:%i) Invalid request.", request.remote_addr.c_str(), request.remote_port));
+
+			return;
+		}
+
+		std::vector<decltype(archives)::iterator> selected; // The archive(s) to search.
+		bool cross{false}; // POST({"archives": [...], ...}), see search_pool.
+
+		{
+			const auto find{[&](const rapidjson::Value & name) {
+				const auto archive{std::find_if(
+					archives.begin()
+					, archives.end()
+					, [_name{std::string_view{name.GetString(), name.GetStringLength()}}](const auto & x) {
+						return x.name == _name;
+					}
+				)};
+
+				if(archive == archives.end()) [[unlikely]] {
+					flog::write(util::format("(%s:%i) Unable to find archive '%s'.", request.remote_addr.c_str(), request.remote_port, name.GetString()));
+
+					return false;
+				}
+
+				if(std::find(selected.begin(), selected.end(), archive) == selected.end()) {
+					selected.emplace_back(archive);
+				}
+
+				return true;
+			}};
+
+			if(const auto _archive{document.FindMember("archive")}; _archive != document.MemberEnd()) {
+				if(!find(_archive->value)) [[unlikely]] {
+					return;
+				}
+			} else {
+				const auto _archives{document.FindMember("archives")};
+
+				if(!_archives->value.IsArray()) [[unlikely]] {
+					flog::write(util::format("(%s:%i) Invalid \"archives\".", request.remote_addr.c_str(), request.remote_port));
+
+					return;
+				}
+
+				for(const auto & i: _archives->value.GetArray()) {
+					if(!i.IsString() || !find(i)) [[unlikely]] {
+						return;
+					}
+				}
+
+				if(selected.empty()) { // All of them.
+					for(auto i{archives.begin()}; i != archives.end(); ++i) {
+						selected.emplace_back(i);
+					}
+				}
+
+				if(selected.empty()) [[unlikely]] {
+					flog::write(util::format("(%s:%i) No archives to search.", request.remote_addr.c_str(), request.remote_port));
+
+					return;
+				}
+
+				cross = true;
+			}
+		}
+
+		{
+			const auto too_short{[&](const std::string & substr) {
+				if constexpr(config::min_search_size > 0) {
+					if(utf8::unchecked::distance(substr.begin(), substr.end()) < config::min_search_size) [[unlikely]] {
+						flog::write(util::format("(%s:%i) Search term '%s' is too short (LOL).", request.remote_addr.c_str(), request.remote_port, substr.c_str()));
+
+						response.set_content("{}", "application/json");
+
+						return true;
+					}
+				}
+
+				return false;
+			}};
+
+			if(const auto _phrases{document.FindMember("phrases")}; _phrases != document.MemberEnd()) {
+				if(
+					!_phrases->value.IsArray()
+					|| _phrases->value.GetArray().Empty()
+					|| _phrases->value.GetArray().Size() > config::phrases_max
+				) [[unlikely]] {
+					flog::write(util::format("(%s:%i) Invalid \"phrases\".", request.remote_addr.c_str(), request.remote_port));
+
+					return;
+				}
+
+				phrases.reserve(_phrases->value.GetArray().Size());
+				for(std::size_t size{0}; const auto & i: _phrases->value.GetArray()) {
+					if(!i.IsString()) [[unlikely]] {
+						flog::write(util::format("(%s:%i) Invalid \"phrases\".", request.remote_addr.c_str(), request.remote_port));
+
+						return;
+					}
+
+					if((size += i.GetStringLength()) > config::phrases_size_max) [[unlikely]] { // Otherwise query::phrases happily allocates a few GB.
+						flog::write(util::format("(%s:%i) \"phrases\" too long (%zu+ bytes).", request.remote_addr.c_str(), request.remote_port, size));
+
+						return;
+					}
+
+					phrases.emplace_back(i.GetString(), i.GetStringLength());
+
+					if(too_short(phrases.back())) [[unlikely]] {
+						return;
+					}
+
+					if(phrases.back().size() > substr.size()) {
+						substr = phrases.back(); // The longest one, for the substr_size below.
+					}
+				}
+			} else {
+				const auto _substr{document.FindMember("substr")};
+
+				substr = std::string{_substr->value.GetString(), _substr->value.GetStringLength()};
+
+				if(too_short(substr)) [[unlikely]] {
+					return;
+				}
+			}
+
+			const auto _substr_size{document.FindMember("substr_size")};
+
+			if(_substr_size != document.MemberEnd()) {
+				substr_size = _substr_size->value.GetInt();
+			}
+		}
+
+		if(const auto _session{document.FindMember("session")}; _session != document.MemberEnd() && _session->value.IsString() && _session->value.GetStringLength() <= 64) {
+			session = std::string{_session->value.GetString(), _session->value.GetStringLength()};
+		}
+
+		if(const auto _words{document.FindMember("words")}; _words != document.MemberEnd() && _words->value.IsBool()) {
+			words = _words->value.GetBool();
+		}
+
+		if(const auto _rank{document.FindMember("rank")}; _rank != document.MemberEnd() && _rank->value.IsUint()) {
+			rank = std::min<std::size_t>(_rank->value.GetUint(), config::rank_max);
+		}
+
+		if(const auto _from{document.FindMember("from")}; _from != document.MemberEnd() && _from->value.IsInt64()) {
+			from = _from->value.GetInt64();
+		}
+
+		if(const auto _to{document.FindMember("to")}; _to != document.MemberEnd() && _to->value.IsInt64()) {
+			to = _to->value.GetInt64();
+		}
+
+		if(const auto format{document.FindMember("format")}; format != document.MemberEnd() && format->value.IsString()) {
+			binary = !cross && phrases.empty() && rank == 0 && std::string_view{format->value.GetString(), format->value.GetStringLength()} == "binary"; // Batch/ranked/cross-archive results are JSON only (the binary format expects results in archive order, of a single archive).
+		}
+
+		substr_size = std::clamp(
+			substr_size
+			, std::max(static_cast<std::remove_cvref_t<decltype(config::substr_size_min)> >(substr.size()), config::substr_size_min)
+			, config::substr_size_max
+		);
+
+		struct searched {
+			std::size_t count; // Hits.
+			std::size_t pages;
+		};
+
+		const auto search{[&]( // Writes the results (a single archive's, see below for the format) to json. Returns std::nullopt if the pattern's invalid.
+			const decltype(archives)::iterator archive
+			, const std::string & session
+			, std::string & json
+			, const bool binary
+		)->std::optional<searched> {
+			std::size_t count{0};
+			std::vector<std::size_t> counts(archive->archive.size(), 0);
+
+			struct hit {
+				std::ptrdiff_t archive; // Index into archive->archive.
+				std::size_t offset;
+				std::size_t size;
+				std::size_t length; // In code points.
+				config::timestamp_type timestamp;
+				std::size_t phrase; // Index into phrases (batch search only).
+			};
+
+			struct result { // Hits whose context windows overlap, merged into a single snippet.
+				std::ptrdiff_t archive;
+				std::string_view snippet;
+				std::size_t begin; // hits index.
+				std::size_t end; // ^.
+			};
+
+			struct page {
+				std::ptrdiff_t archive;
+				std::size_t begin;
+				std::size_t end;
+			};
+
+			thread_local std::vector<hit> hits; // Reused between requests, same as util::thread_buffer().
+			thread_local std::vector<result> results; // ^.
+			const util::shrink_on_exit shrink_hits{hits, config::buffer_size_max};
+			const util::shrink_on_exit shrink_results{results, config::buffer_size_max};
+			std::vector<std::size_t> archive_pages(archive->archive.size(), 0);
+			std::vector<std::vector<page> > pages{1};
+
+			hits.clear();
+			results.clear();
+
+			std::vector<std::size_t> phrase_counts(phrases.size(), 0);
+			const auto sources{archive->archive.slice(from, to)}; // Only these get searched, everything else is simply skipped.
+			const auto
+				sources_begin{static_cast<std::size_t>(sources.data()-archive->archive.data())}
+				, sources_end{sources_begin+sources.size()}
+			;
+
+			const auto hit_f{[&](
+				const std::string_view text
+				, const std::size_t result_offset
+				, const std::size_t result_size
+				, const config::timestamp_type timestamp
+				, const archive::source & source
+				, const std::size_t phrase = 0
+			) {
+	#ifdef USE_REGEX
+				if(result_size > config::substr_size_max) { // FIXME: Using *_size is incorrect but saves cycles.
+					return;
+				}
+	#endif // USE_REGEX
+
+				const auto result_length{utf8::unchecked::distance(text.begin()+result_offset, (text.begin()+result_offset)+result_size)}; // Not necessarily the length of substr, see query::pattern.
+
+				++count;
+				++counts[&source-&(*archive->archive.begin())];
+
+				if(!phrases.empty()) {
+					++phrase_counts[phrase];
+				}
+
+				hits.emplace_back(hit{
+					.archive = &source-&(*archive->archive.begin())
+					, .offset = result_offset
+					, .size = result_size
+					, .length = static_cast<std::size_t>(result_length)
+					, .timestamp = timestamp
+					, .phrase = phrase
+				});
+			}};
+
+			if((words || rank > 0) && phrases.empty()) {
+				thread_local std::vector<std::string_view> terms;
+				const util::shrink_on_exit shrink_terms{terms, config::buffer_size_max};
+
+				terms.clear();
+				util::words(substr, [&](const std::size_t offset, const std::size_t size) {
+					terms.emplace_back(std::string_view{substr}.substr(offset, size));
+				});
+
+				if(rank > 0) { // Best sources first, and only their hits.
+					thread_local std::vector<word_index::ranked> ranked;
+					thread_local std::vector<std::uint32_t> top;
+					const util::shrink_on_exit shrink_ranked{ranked, config::buffer_size_max};
+					const util::shrink_on_exit shrink_top{top, config::buffer_size_max};
+					std::vector<std::size_t> order(archive->archive.size(), 0); // Source -> its place in ranked.
+
+					archive->words.rank(archive->archive, sources, terms, rank, &ranked);
+
+					top.clear();
+					for(const auto & i: ranked) {
+						order[i.source] = static_cast<std::size_t>(&i-ranked.data());
+						top.emplace_back(i.source);
+					}
+					std::sort(top.begin(), top.end());
+
+					archive->words.find_any(archive->archive, top, terms, hit_f);
+
+					std::sort(
+						hits.begin()
+						, hits.end()
+						, [&](const auto & lhs, const auto & rhs) {return order[lhs.archive] < order[rhs.archive] || (lhs.archive == rhs.archive && lhs.offset < rhs.offset);}
+					);
+				} else {
+					archive->words.find(archive->archive, sources, terms, hit_f);
+				}
+			} else if(phrases.empty()) {
+				const query::pattern pattern{substr}; // Compiled (or fetched from the cache) once per request.
+
+				if(!pattern.ok()) [[unlikely]] {
+					flog::write(util::format("(%s:%i) Invalid pattern '%s'.", request.remote_addr.c_str(), request.remote_port, substr.c_str()), flog::Level::warning);
+
+					return std::nullopt;
+				}
+
+				if(
+					pattern.type() == query::pattern::kind::literal
+					&& !session.empty()
+				) {
+					const auto & literal{pattern.literals().front()};
+					const auto previous{query::sessions().get(session)};
+					auto shift{std::string_view::npos};
+
+					if(
+						previous != nullptr
+						&& previous->archive == archive->name
+						&& previous->version == archive->archive.size()
+						&& previous->begin <= sources_begin
+						&& previous->end >= sources_end
+					) {
+						shift = query::refines(previous->literal, literal);
+					}
+
+					if(shift != std::string_view::npos) {
+						flog::write(util::format("(%s:%i) Refining '%s' (%zu hits).", request.remote_addr.c_str(), request.remote_port, previous->literal.c_str(), previous->hits.size()), flog::Level::debug);
+
+						archive->archive.refine(sources, literal, shift, previous->hits, hit_f);
+					} else {
+						archive->archive.find(sources, pattern, hit_f);
+					}
+
+					if(hits.size() <= config::session_hits_max) {
+						auto _session{std::make_shared<query::session>(query::session{
+							.archive = archive->name
+							, .version = archive->archive.size()
+							, .begin = sources_begin
+							, .end = sources_end
+							, .literal = literal
+							, .hits = {}
+						})};
+
+						_session->hits.reserve(hits.size());
+						for(const auto & i: hits) {
+							_session->hits.emplace_back(query::position{.source = static_cast<std::size_t>(i.archive), .offset = i.offset});
+						}
+
+						query::sessions().put(session, std::move(_session));
+					}
+				} else {
+					archive->archive.find(sources, pattern, hit_f);
+				}
+			} else {
+				archive->archive.find(sources, query::phrases{phrases}, hit_f); // A single pass over the archive, no matter how many phrases there are. Phrases are always literals (even with USE_REGEX).
+
+				std::stable_sort( // Matches come out ordered by their *end* offset.
+					hits.begin()
+					, hits.end()
+					, [](const auto & lhs, const auto & rhs) {return lhs.archive < rhs.archive || (lhs.archive == rhs.archive && lhs.offset < rhs.offset);}
+				);
+			}
+
+			if(count == 0 && !binary) {
+				return searched{.count = 0, .pages = 0};
+			}
+
+			const auto snippet{[&](const hit & i) { // Context window of a single hit.
+				const auto text{std::string_view{archive->archive[i.archive].text.data}};
+				const auto prior{[&](auto & i, const auto begin, const std::size_t length) {
+					std::size_t size{0};
+
+					for(std::size_t _i{0}; i > begin && _i < length; ++size, ++_i) {
+						for(--i; utf8::internal::is_trail(*i); --i) {
+						}
+					}
+
+					return size;
+				}};
+
+				auto
+					begin{text.data()+i.offset}
+					, end{(text.data()+i.offset)+i.size} // The actual match (which is *not* necessarily substr.size() bytes long when using a regex), so that the highlights are always inside of the snippet.
+				;
+				const auto context{static_cast<std::size_t>(substr_size) > i.length ? static_cast<std::size_t>(substr_size)-i.length : 0}; // A regex match can be longer than substr_size.
+				const auto left_length{prior(begin, text.data(), context/2)};
+
+				for(
+					std::size_t j{0}
+					; end < (text.data()+text.size()) && j < (context-left_length)
+					; ++j
+				) {
+					utf8::unchecked::next(end);
+				}
+
+				return std::string_view{begin, static_cast<std::size_t>(end-begin)};
+			}};
+
+			results.reserve(hits.size());
+			for(std::size_t i{0}; i < hits.size(); ++i) {
+				const auto _snippet{snippet(hits[i])};
+
+				if(!results.empty()) {
+					auto & _result{results.back()};
+					const auto & first{hits[_result.begin]};
+
+					if(
+						_result.archive == hits[i].archive
+						&& _snippet.data() < _result.snippet.data()+_result.snippet.size() // Overlap.
+						&& static_cast<std::size_t>(utf8::unchecked::distance( // Don't let a chatty stream merge everything into a single wall of text: first..last hit has to fit into a single window.
+							archive->archive[first.archive].text.data.data()+first.offset
+							, archive->archive[hits[i].archive].text.data.data()+(hits[i].offset+hits[i].size)
+						)) <= static_cast<std::size_t>(substr_size)
+					) {
+						_result.snippet = std::string_view{
+							_result.snippet.data()
+							, static_cast<std::size_t>(std::max(_result.snippet.data()+_result.snippet.size(), _snippet.data()+_snippet.size())-_result.snippet.data())
+						};
+						_result.end = i+1;
+
+						continue;
+					}
+				}
+
+				results.emplace_back(result{
+					.archive = hits[i].archive
+					, .snippet = _snippet
+					, .begin = i
+					, .end = i+1
+				});
+			}
+
+			for(std::size_t page_length{0}; const auto & i: results) {
+				const auto result_index{static_cast<std::size_t>(&i-results.data())};
+
+				if(pages.back().empty() || pages.back().back().archive != i.archive) {
+					if(!pages.back().empty()) {
+						pages.back().back().end = result_index;
+					}
+
+					pages.back().emplace_back(page{
+						.archive = i.archive
+						, .begin = result_index
+						, .end = {}
+					});
+					archive_pages[i.archive] = pages.size()-1;
+				}
+
+				if(++page_length >= config::results_per_page) {
+					pages.back().back().end = result_index+1;
+
+					pages.resize(pages.size()+1);
+					page_length = 0;
+				}
+			}
+
+			if(!pages.back().empty()) {
+				pages.back().back().end = results.size();
+			} else {
+				pages.pop_back(); // In case the last page ended exactly at results_per_page (or there are no results at all).
+			}
+
+			const auto highlights{[&](const result & i) -> const auto & { // [offset, length] pairs, in UTF-16 code units (because that's what JS strings use) relative to the snippet. Not one per hit: overlapping (or adjacent) hits get merged into a single range, since batch phrases can nest ("abc" and "b") and the conversion below only ever moves forward.
+				thread_local std::vector<std::pair<std::size_t, std::size_t> > ranges; // Reused between results, same as hits.
+
+				ranges.clear();
+				for(std::size_t j{i.begin}; j < i.end; ++j) {
+					ranges.emplace_back(hits[j].offset, hits[j].offset+hits[j].size); // [begin, end), bytes into the text for now.
+				}
+				std::sort(ranges.begin(), ranges.end());
+
+				std::size_t size{0};
+
+				for(std::size_t j{0}; j < ranges.size(); ++j) {
+					if(size > 0 && ranges[j].first <= ranges[size-1].second) {
+						ranges[size-1].second = std::max(ranges[size-1].second, ranges[j].second);
+					} else {
+						ranges[size++] = ranges[j];
+					}
+				}
+				ranges.resize(size);
+
+				const auto * text{archive->archive[i.archive].text.data.data()};
+				const auto * p{i.snippet.data()};
+				std::size_t offset{0};
+
+				const auto advance{[&p](const char * const end) {
+					std::size_t length{0};
+
+					while(p < end) {
+						length += utf8::unchecked::next(p) > 0xFFFF ? 2 : 1;
+					}
+
+					return length;
+				}};
+
+				for(auto & j: ranges) {
+					offset += advance(text+j.first);
+
+					const auto length{advance(text+j.second)};
+
+					j = {offset, length};
+					offset += length;
+				}
+
+				return ranges;
+			}};
+
+			if(binary) {
+				/*
+				"alog" 5                          // Magic, format version (byte).
+				count                             // Number of results (after merging).
+				version
+				archive.size() [count]            // Hits count for each archive.
+				pages.size() [                    // Same as "pages" below.
+					ranges.size() [begin end]
+				]
+				[archive_page]                    // archive.size() entries, same as "archive_pages" below.
+				[                                 // count entries.
+					s                             // Snippet index. s == (number of snippets seen so far) means a new snippet follows: length [byte].
+					t                             // Timestamp (of the first hit, milliseconds).
+					o                             // Offset (of the first hit).
+					i-(previous i)                // Archive index (delta, results are grouped by archive).
+					n                             // Number of hits.
+					m [offset length]             // Highlights (see "h" below), offset is relative to the end of the previous highlight.
+					[zigzag(ts-(previous ts))]    // n-1 entries, timestamps of the remaining hits.
+				]
+
+				Every number except for the format version is a varint (unsigned LEB128).
+				*/
+
+				thread_local std::unordered_map<std::string_view, std::size_t> snippets; // string_views point into archive::source::text, so no copies here.
+				const util::shrink_on_exit shrink_snippets{snippets, config::buffer_size_max};
+
+				snippets.clear();
+				snippets.reserve(results.size());
+				json.reserve(results.size()*(substr_size/2+8)+archive->archive.size()*4); // Snippets get deduplicated, so we're (hopefully) overestimating here.
+
+				json += "alog\x05";
+				util::varint(&json, results.size());
+				util::varint(&json, archive->archive.size());
+				util::varint(&json, counts.size());
+				for(const auto i: counts) {
+					util::varint(&json, i);
+				}
+				util::varint(&json, pages.size());
+				for(const auto & i: pages) {
+					util::varint(&json, i.size());
+					for(const auto & j: i) {
+						util::varint(&json, j.begin);
+						util::varint(&json, j.end);
+					}
+				}
+				for(const auto i: archive_pages) {
+					util::varint(&json, i);
+				}
+				for(std::ptrdiff_t archive_index{0}; const auto & i: results) {
+					const auto [j, inserted]{snippets.try_emplace(i.snippet, snippets.size())};
+
+					util::varint(&json, j->second);
+					if(inserted) {
+						util::varint(&json, i.snippet.size());
+						json += i.snippet;
+					}
+					util::varint(&json, std::size_t{hits[i.begin].timestamp});
+					util::varint(&json, hits[i.begin].offset);
+					util::varint(&json, static_cast<std::size_t>(i.archive-archive_index));
+
+					util::varint(&json, i.end-i.begin);
+					{
+						const auto & _highlights{highlights(i)};
+						std::size_t previous{0};
+
+						util::varint(&json, _highlights.size());
+						for(const auto & [offset, length]: _highlights) {
+							util::varint(&json, offset-previous);
+							util::varint(&json, length);
+
+							previous = offset+length;
+						}
+					}
+					for(std::size_t j{i.begin+1}; j < i.end; ++j) {
+						util::varint(&json, util::zigzag(static_cast<std::int64_t>(hits[j].timestamp)-static_cast<std::int64_t>(hits[j-1].timestamp)));
+					}
+
+					archive_index = i.archive;
+				}
+			} else {
+				/*
+				{
+					"search": [
+						{
+							"s": String   // substr
+							, "t": Number // timestamp (of the first hit, milliseconds)
+							, "o": Number // Offset (of the first hit) into the source's text, for POST({"expand": ...})
 							, "i": Number // archive index (into an array obtained by POST(get_archive))
+							, "h": [      // Highlights, [offset, length] pairs (UTF-16 code units) into "s", overlapping hits merged into one
+								Number
+							]
+							, "ts": [     // Timestamps of all of the hits, omitted if there's only one
+								Number
+							]
+							, "p": [      // Phrase index (into the request's "phrases") of each hit, batch search only
+								Number
+							]
 						}
 					]
-					, "archive": [ // Results count for each archive. Needed to scale the bars
+					, "phrases": [ // Hits count for each phrase, batch search only
+						Number
+					]
+					, "archive": [ // Hits count for each archive. Needed to scale the bars
 						Number
 					]
 					, "version": Number
@@ -663,163 +2123,194 @@ config.example.json:
 				}
 				*/
 
-				++count;
-				++counts[&source-&(*archive->archive.begin())];
+				json.reserve(results.size()*(substr_size+48)+archive->archive.size()*16); // 48 ~= strlen("{\"s\":\"\",\"t\":65535,\"i\":65535,\"h\":[255,255]},") and then some.
 
-				{
-					const auto _archive{&source-&(*archive->archive.begin())};
+				json += "{\"search\":";
+				for(char separator{'['}; const auto & i: results) {
+					util::strcat(
+						&json
+						, separator
+						, "{\"s\":\""
+						, i.snippet
+						, "\",\"t\":"
+						, hits[i.begin].timestamp
+						, ",\"o\":"
+						, hits[i.begin].offset
+						, ",\"i\":"
+						, i.archive
+						, ",\"h\":"
+					);
+					for(char _separator{'['}; const auto & [offset, length]: highlights(i)) {
+						util::strcat(&json, _separator, offset, ',', length);
 
-					if(pages.back().empty() || pages.back().back().archive != _archive) {
-						if(!pages.back().empty()) {
-							pages.back().back().end = result_index;
+						_separator = ',';
+					}
+					json += ']';
+					if(!phrases.empty()) {
+						json += ",\"p\":";
+						for(char _separator{'['}; const auto & j: std::span{hits.data()+i.begin, hits.data()+i.end}) {
+							util::strcat(&json, _separator, j.phrase);
+
+							_separator = ',';
 						}
+						json += ']';
+					}
+					if(i.end-i.begin > 1) {
+						json += ",\"ts\":";
+						for(char _separator{'['}; const auto & j: std::span{hits.data()+i.begin, hits.data()+i.end}) {
+							util::strcat(&json, _separator, j.timestamp);
 
-						pages.back().emplace_back(page{
-							.archive = _archive
-							, .begin = result_index
-							, .end = {}
-						});
-						archive_pages[_archive] = pages.size()-1;
+							_separator = ',';
+						}
+						json += ']';
 					}
+					json += '}';
 
-					++page_length;
-					++result_index;
+					separator = ',';
+				}
+				json += ']';
 
-					if(page_length >= config::results_per_page) {
-						pages.back().back().end = result_index;
+				json += ",\"archive\":";
+				for(char separator{'['}; const auto i: counts) {
+					util::strcat(&json, separator, i);
 
-						pages.resize(pages.size()+1);
-						page_length = 0;
-					}
+					separator = ',';
 				}
+				util::strcat(
+					&json
+					, ']'
 
-				util::strcat(&json, separator, "{\"s\":\"");
-
-				{
-					const auto prior{[&](auto & i, const auto begin, const std::size_t length) {
-						std::size_t size{0};
+					, ','
+					, "\"version\":"
+					, archive->archive.size() // TODO: Cache entire JSON string and version (which should be something more reliable than "size").
+				);
 
-						for(std::size_t _i{0}; i > begin && _i < length; ++size, ++_i) {
-							for(--i; utf8::internal::is_trail(*i); --i) {
-							}
-						}
+				if(!phrases.empty()) {
+					json += ",\"phrases\":";
+					for(char separator{'['}; const auto i: phrase_counts) {
+						util::strcat(&json, separator, i);
 
-						return size;
-					}};
-
-					auto
-						begin{text.data()+result_offset}
-						, end{
-#ifdef USE_REGEX
-							std::min( // Needed in case we're using a regex and (offset+result_length >= text.size()).
-								(text.data()+result_offset)+substr.size()
-								, (text.data()+text.size())-1
-							)
-#else // !USE_REGEX
-							(text.data()+result_offset)+substr.size()
-#endif // USE_REGEX
-						}
-					;
-					const auto left_length{prior(begin, text.data(), (substr_size-result_length)/2)};
+						separator = ',';
+					}
+					json += ']';
+				}
 
-					for(
-						std::size_t i{0}
-						; end < (text.data()+text.size()) && i < (substr_size-(left_length+result_length))
-						; ++i
-					) {
-						utf8::unchecked::next(end);
+				json += ",\"pages\":[";
+				for(char separator(' '); const auto & i: pages) {
+					util::strcat(&json, separator, '[');
+					for(char _separator(' '); const auto & j: i) {
+						util::strcat(
+							&json
+							, _separator
+							, "{\"begin\":"
+							, j.begin
+							, ",\"end\":"
+							, j.end
+							, '}'
+						);
+
+						_separator = ',';
 					}
+					json += ']';
 
-					json += std::string_view{begin, static_cast<std::size_t>(end-begin)};
+					separator = ',';
 				}
-
 				util::strcat(
 					&json
-					, "\",\"t\":"
-					, std::to_string(timestamp)
-					, ",\"i\":"
-					, std::to_string(&source-&(*archive->archive.begin()))
-					, '}'
+					, ']'
+
+					, ",\"archive_pages\":["
 				);
+				for(char separator(' '); const auto i: archive_pages) {
+					util::strcat(&json, separator, i);
 
-				separator = ',';
+					separator = ',';
+				}
+				json += ']';
+
+				json += '}';
 			}
-		);
 
-		if(count == 0) {
-			response.set_content("{}", "application/json");
+			return searched{.count = count, .pages = pages.size()};
 
-			return;
-		}
-		util::strcat(
-			&json
-			, ']'
+		}};
 
-			, ','
-			, "\"archive\":"
-		);
-		if(count > 0) {
-			separator = '[';
-			for(const auto & i: archive->archive) {
-				util::strcat(
-					&json
-					, separator
-					, std::to_string(counts[&i-&(*archive->archive.begin())])
-				);
+		std::size_t count{0};
+		auto & json{util::thread_buffer()}; // Not necessarily JSON, but whatever.
 
-				separator = ',';
+		if(!cross) {
+			const auto result{search(selected.front(), session, json, binary)};
+
+			if(!result || (result->count == 0 && !binary)) {
+				response.set_content("{}", "application/json");
+
+				return;
 			}
-		} else {
-			json += '[';
-		}
-		util::strcat(
-			&json
-			, ']'
 
-			, ','
-			, "\"version\":"
-			, std::to_string(archive->archive.size()) // TODO: Cache entire JSON string and version (which should be something more reliable than "size").
-		);
-		if(!pages.back().empty()) {
-			pages.back().back().end = result_index;
+			count = result->count;
+			response.set_content(json.data(), json.size(), binary ? "application/octet-stream" : "application/json");
+		} else { // Every archive on a thread of its own (as far as search_pool goes), largest first so that the one that takes the longest starts right away.
+			/*
+			{
+				"archives": [ // In the order they were asked for (all of them, for "archives": [])
+					{
+						"name": String
+						, "count": Number   // Hits
+						, "result": Object  // What POST({"archive": name, ...}) would've returned, {} if there's nothing
+					}
+				]
+				, "count": Number // Total hits, across all archives
+				, "pages": [      // Every archive's "pages", one archive after another
+					[
+						Number    // "archives" index
+						, Number  // "pages" index (into that archive's "result")
+					]
+				]
+			}
+			*/
 
-			json += ",\"pages\":[";
-			for(char separator(' '); const auto & i: pages) {
-				util::strcat(&json, separator, '[');
-				for(char _separator(' '); const auto & j: i) {
-					util::strcat(
-						&json
-						, _separator
-						, "{\"begin\":"
-						, std::to_string(j.begin)
-						, ",\"end\":"
-						, std::to_string(j.end)
-						, '}'
-					);
+			std::vector<std::string> jsons(selected.size()); // Per archive.
+			std::vector<std::optional<searched> > _searched(selected.size());
+			std::vector<std::size_t> order(selected.size());
 
-					_separator = ',';
-				}
-				json += ']';
+			for(std::size_t i{0}; i < order.size(); ++i) {
+				order[i] = i;
+			}
+			std::sort(order.begin(), order.end(), [&](const auto lhs, const auto rhs) {return selected[lhs]->archive.size() > selected[rhs]->archive.size();});
 
-				separator = ',';
+			search_pool.run(order.size(), [&](const std::size_t i) {
+				const auto j{order[i]};
+
+				_searched[j] = search(selected[j], session.empty() ? session : session+'\n'+selected[j]->name, jsons[j], false); // Sessions are per archive.
+			});
+
+			if(!_searched.front()) [[unlikely]] { // The pattern is the same for everyone.
+				response.set_content("{}", "application/json");
+
+				return;
 			}
-			util::strcat(
-				&json
-				, ']'
 
-				, ",\"archive_pages\":["
-			);
-			for(char separator(' '); const auto i: archive_pages) {
-				util::strcat(&json, separator, std::to_string(i));
+			json += "{\"archives\":";
+			for(char separator{'['}; const auto & i: selected) {
+				const auto j{static_cast<std::size_t>(&i-selected.data())};
+
+				util::strcat(&json, separator, "{\"name\":\"", util::json_escaped{i->name}, "\",\"count\":", _searched[j]->count, ",\"result\":", jsons[j].empty() ? std::string_view{"{}"} : std::string_view{jsons[j]}, '}');
+				count += _searched[j]->count;
 
 				separator = ',';
 			}
-			json += ']';
-		}
+			util::strcat(&json, "],\"count\":", count, ",\"pages\":[");
+			for(char separator{' '}; const auto & i: _searched) {
+				for(std::size_t j{0}; j < i->pages; ++j) {
+					util::strcat(&json, separator, '[', static_cast<std::size_t>(&i-_searched.data()), ',', j, ']');
 
-		json += '}';
+					separator = ',';
+				}
+			}
+			json += "]}";
 
-		response.set_content(json, "application/json");
+			response.set_content(json.data(), json.size(), "application/json");
+		}
 
 		flog::write(util::format(
 			"(%s:%i) %zu results in %.2fms (%.2fMiB)."
@@ -833,5 +2324,9 @@ config.example.json:
 
 	flog::write(util::format("server.listen('%s', '%i').", server_listen_ip.c_str(), server_listen_port), flog::Level::info);
 
-	return server.listen(server_listen_ip, server_listen_port) ? EXIT_SUCCESS : EXIT_FAILURE;
+	const auto result{server.listen(server_listen_ip, server_listen_port)};
+
+	trends_thread.join();
+
+	return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,452 @@
+#pragma once
+
+#include "config.hpp"
+#include "util.hpp"
+
+#ifdef USE_REGEX
+#include <re2/re2.h>
+#endif // USE_REGEX
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace query {
+
+namespace detail {
+
+template<typename T>
+class lru { // Least recently used cache of shared_ptr<const T>s, thread-safe.
+public:
+	explicit lru(
+		const std::size_t capacity
+	):
+		_capacity{capacity}
+	{
+	}
+
+	std::shared_ptr<const T> get(
+		const std::string_view key
+	) {
+		std::lock_guard<std::mutex> lock_guard(_mutex);
+
+		if(const auto i{_map.find(key)}; i != _map.end()) {
+			_list.splice(_list.begin(), _list, i->second);
+
+			return i->second->second;
+		}
+
+		return {};
+	}
+
+	void put(
+		const std::string_view key
+		, std::shared_ptr<const T> value
+	) {
+		std::lock_guard<std::mutex> lock_guard(_mutex);
+
+		if(const auto i{_map.find(key)}; i != _map.end()) {
+			_list.splice(_list.begin(), _list, i->second);
+			i->second->second = std::move(value);
+
+			return;
+		}
+
+		_list.emplace_front(std::string{key}, std::move(value));
+		_map.emplace(_list.front().first, _list.begin());
+
+		if(_list.size() > _capacity) {
+			_map.erase(_list.back().first);
+			_list.pop_back();
+		}
+	}
+
+private:
+	std::mutex _mutex;
+	std::size_t _capacity;
+	std::list<std::pair<std::string, std::shared_ptr<const T> > > _list; // Most recently used first.
+	std::unordered_map<std::string_view, typename decltype(_list)::iterator> _map; // Keys point into _list.
+};
+
+#ifdef USE_REGEX
+inline
+std::shared_ptr<const re2::RE2> regex( // Compiled regexes are cached, because compiling the same thing over and over again on every keystroke is silly.
+	const std::string_view pattern
+) {
+	static lru<re2::RE2> cache{config::regex_cache_size};
+	re2::RE2::Options options;
+
+	options.set_log_errors(false);
+	options.set_max_mem(config::regex_max_mem);
+
+	const auto key{util::format("%ji:", static_cast<std::intmax_t>(options.max_mem()))+std::string{pattern}}; // Options that we actually change, followed by the pattern.
+
+	if(auto regex{cache.get(key)}; regex != nullptr) {
+		return regex;
+	}
+
+	auto regex{std::make_shared<const re2::RE2>(absl::string_view(pattern.data(), pattern.size()), options)};
+
+	if(
+		!regex->ok()
+		|| re2::RE2::FullMatch(absl::string_view{}, *regex) // "x?y?z?" and friends would match at every single byte of the archive.
+	) {
+		return {};
+	}
+
+	cache.put(key, regex); // Two threads might compile the same thing at the same time, whatever.
+
+	return regex;
+}
+
+inline
+bool literals( // Splits a regex into literal alternatives ("a|b\.c" -> {"a", "b.c"}), returns false if it's anything more complicated than that.
+	std::string_view pattern
+	, std::vector<std::string> * literals
+) {
+	if(
+		pattern.size() >= 2
+		&& pattern.front() == '('
+		&& pattern.back() == ')'
+		&& pattern.find_first_of("()", 1) == pattern.size()-1 // "(a|b)", but not "(a)|(b)".
+	) {
+		pattern = pattern.substr(1, pattern.size()-2);
+	}
+
+	literals->assign(1, std::string{});
+
+	for(std::size_t i{0}; i < pattern.size(); ++i) {
+		const auto c{pattern[i]};
+
+		if(c == '\\') {
+			if(
+				++i == pattern.size()
+				|| std::isalnum(static_cast<unsigned char>(pattern[i])) // \b, \d, \pN, \x41, etc.
+				|| static_cast<unsigned char>(pattern[i]) >= 0x80
+			) {
+				return false;
+			}
+
+			literals->back() += pattern[i];
+		} else if(c == '|') {
+			if(literals->back().empty()) {
+				return false;
+			}
+
+			literals->emplace_back();
+		} else if(std::string_view{".^$?*+()[]{}"}.find(c) != std::string_view::npos) {
+			return false;
+		} else {
+			literals->back() += c;
+		}
+	}
+
+	return !literals->back().empty();
+}
+#endif // USE_REGEX
+
+} // namespace detail
+
+class pattern {
+public:
+	enum class kind {
+		literal // Plain substring, the SIMD (StringZilla) path.
+		, literals // Alternation of plain substrings.
+		, regex
+	};
+
+	template<typename T>
+	explicit pattern(
+		T && substr
+	) {
+#ifdef USE_REGEX
+		if(detail::literals(substr, &_literals)) {
+			_kind = _literals.size() == 1 ? kind::literal : kind::literals;
+
+			return;
+		}
+
+		_literals.clear();
+		_kind = kind::regex;
+		_regex = detail::regex(substr);
+#else // !USE_REGEX
+		_literals.emplace_back(std::forward<T>(substr));
+		_kind = kind::literal;
+#endif // USE_REGEX
+	}
+
+	constexpr auto type() const {return _kind;}
+	constexpr const auto & literals() const {return _literals;}
+
+	bool ok() const {
+#ifdef USE_REGEX
+		if(_kind == kind::regex) {
+			return _regex != nullptr;
+		}
+#endif // USE_REGEX
+
+		return true;
+	}
+
+	template<typename T, typename F>
+	void find( // f(offset, size) for every (non-overlapping, leftmost-first) match in text.
+		const T & text
+		, F && f
+	) const {
+		switch(_kind) {
+			case kind::literal: {
+				const auto & literal{_literals.front()};
+
+				for(
+					std::size_t j{text.find(literal)}
+					; j != T::npos
+					; j = text.find(literal, j+literal.size())
+				) {
+					f(j, literal.size());
+				}
+
+				break;
+			}
+			case kind::literals: { // Next occurrence of every literal, the leftmost one wins (the first alternative in case of a tie, same as RE2). Each literal is only ever scanned once, so this is about as fast as _literals.size() SIMD scans.
+				thread_local std::vector<std::size_t> next;
+
+				next.resize(_literals.size());
+				for(std::size_t i{0}; i < _literals.size(); ++i) {
+					next[i] = text.find(_literals[i]);
+				}
+
+				for(;;) {
+					const auto i{std::min_element(next.begin(), next.end())-next.begin()};
+					const auto j{next[i]};
+
+					if(j == T::npos) {
+						break;
+					}
+
+					f(j, _literals[i].size());
+
+					for(std::size_t k{0}; k < _literals.size(); ++k) {
+						if(next[k] != T::npos && next[k] < j+_literals[i].size()) {
+							next[k] = text.find(_literals[k], j+_literals[i].size());
+						}
+					}
+				}
+
+				break;
+			}
+			case kind::regex: {
+#ifdef USE_REGEX
+				const absl::string_view _text(text.data(), text.size());
+
+				for(std::size_t position{0}; position <= _text.size();) {
+					absl::string_view match;
+
+					if(!_regex->Match(_text, position, _text.size(), re2::RE2::UNANCHORED, &match, 1)) { // No capture groups, we only need the bounds of the entire match.
+						break;
+					}
+
+					const auto offset{static_cast<std::size_t>(match.data()-_text.data())};
+
+					if(!match.empty()) { // Skip empty matches ("a*"), there's nothing to highlight anyway.
+						f(offset, match.size());
+					}
+
+					position = offset+std::max<std::size_t>(match.size(), 1);
+				}
+#endif // USE_REGEX
+
+				break;
+			}
+		}
+	}
+
+private:
+	kind _kind;
+	std::vector<std::string> _literals;
+#ifdef USE_REGEX
+	std::shared_ptr<const re2::RE2> _regex;
+#endif // USE_REGEX
+};
+
+class phrases { // Aho-Corasick (full DFA, 256 transitions per state) for searching a bunch of literals in a single pass. That's 1 KiB per state, and there can be as many states as there are bytes in all of the literals, so keep them short (see config::phrases_size_max).
+public:
+	template<typename T>
+	explicit phrases(
+		const T & phrases
+	) {
+		_next.assign(256, 0);
+		_output.assign(1, none);
+		_link.assign(1, none);
+		_first.fill(false);
+
+		for(const auto & i: phrases) {
+			const std::string_view phrase{i};
+			std::uint32_t state{0};
+
+			for(const auto c: phrase) {
+				auto & next{_next[state*256+static_cast<unsigned char>(c)]};
+
+				if(next == 0) {
+					next = static_cast<std::uint32_t>(_output.size());
+
+					_next.resize(_next.size()+256, 0);
+					_output.emplace_back(none);
+					_link.emplace_back(none);
+				}
+
+				state = _next[state*256+static_cast<unsigned char>(c)]; // _next might've been reallocated.
+			}
+
+			if(!phrase.empty()) {
+				_first[static_cast<unsigned char>(phrase.front())] = true;
+			}
+
+			_same.emplace_back(_output[state]); // Duplicates get chained.
+			_output[state] = static_cast<std::uint32_t>(_sizes.size());
+			_sizes.emplace_back(phrase.size());
+		}
+
+		std::vector<std::uint32_t> fail(_output.size(), 0);
+		std::vector<std::uint32_t> queue;
+
+		queue.reserve(_output.size());
+		for(unsigned c{0}; c < 256; ++c) {
+			if(_next[c] != 0) {
+				queue.emplace_back(_next[c]);
+			}
+		}
+
+		for(std::size_t i{0}; i < queue.size(); ++i) { // BFS, so that fail[] of shallower states is always ready.
+			const auto state{queue[i]};
+
+			_link[state] = _output[fail[state]] != none ? fail[state] : _link[fail[state]];
+
+			for(unsigned c{0}; c < 256; ++c) {
+				auto & next{_next[state*256+c]};
+
+				if(next != 0) {
+					fail[next] = _next[fail[state]*256+c];
+					queue.emplace_back(next);
+				} else {
+					next = _next[fail[state]*256+c];
+				}
+			}
+		}
+	}
+
+	constexpr auto size() const {return _sizes.size();}
+
+	template<typename T, typename F>
+	void find( // f(offset, size, phrase) for every match. Every phrase gets the same (non-overlapping) matches a separate search would produce, ordered by their end offset.
+		const T & text
+		, F && f
+	) const {
+		thread_local std::vector<std::size_t> end; // End of the previous match of each phrase.
+
+		end.assign(_sizes.size(), 0);
+
+		const auto * data{reinterpret_cast<const unsigned char *>(text.data())};
+		const auto size{text.size()};
+
+		for(std::size_t i{0}, state{0}; i < size; ++i) {
+			if(state == 0) { // Nothing in progress, skip whatever can't start a phrase.
+				for(; i < size && !_first[data[i]]; ++i) {
+				}
+
+				if(i == size) {
+					break;
+				}
+			}
+
+			state = _next[state*256+data[i]];
+
+			for(auto j{_output[state] != none ? static_cast<std::uint32_t>(state) : _link[state]}; j != none; j = _link[j]) {
+				for(auto phrase{_output[j]}; phrase != none; phrase = _same[phrase]) {
+					const auto begin{(i+1)-_sizes[phrase]};
+
+					if(begin >= end[phrase]) {
+						f(begin, _sizes[phrase], static_cast<std::size_t>(phrase));
+
+						end[phrase] = i+1;
+					}
+				}
+			}
+		}
+	}
+
+private:
+	static constexpr std::uint32_t none{~std::uint32_t{0}};
+
+	std::vector<std::uint32_t> _next; // [state*256+c].
+	std::vector<std::uint32_t> _output; // [state] = (last) phrase ending at state, or none.
+	std::vector<std::uint32_t> _link; // [state] = the closest state (following the failure links) with an output, or none.
+	std::vector<std::uint32_t> _same; // [phrase] = previous phrase identical to this one, or none.
+	std::vector<std::size_t> _sizes; // [phrase].
+	std::array<bool, 256> _first; // Can c start a phrase?
+};
+
+struct position { // Of a hit.
+	std::size_t source; // Index into archive.
+	std::size_t offset; // Into source::text.
+};
+
+struct session { // Last (literal) search of a client, see refines().
+	std::string archive;
+	std::size_t version; // archive's, see POST({"get_archive": ...}).
+	std::size_t begin; // Range of sources that was searched, see archive::slice().
+	std::size_t end; // ^.
+	std::string literal;
+	std::vector<position> hits; // All of them, ordered by source, then offset.
+};
+
+inline
+detail::lru<session> & sessions(
+) {
+	static detail::lru<session> _sessions{config::sessions_max};
+
+	return _sessions;
+}
+
+inline
+std::size_t refines( // Returns the offset of previous in literal if every match of literal is a match of previous shifted by that offset ("mald" -> "maldavius"), npos otherwise.
+	const std::string_view previous
+	, const std::string_view literal
+) {
+	if(
+		previous.empty()
+		|| previous.size() > literal.size()
+	) {
+		return std::string_view::npos;
+	}
+
+	thread_local std::vector<std::size_t> border; // KMP's failure function. Non-overlapping matches of previous are *all* of its matches only if it can't overlap itself ("abab" can, "maldavius" can't).
+
+	border.assign(previous.size(), 0);
+	for(std::size_t i{1}, k{0}; i < previous.size(); ++i) {
+		for(; k > 0 && previous[i] != previous[k]; k = border[k-1]) {
+		}
+
+		if(previous[i] == previous[k]) {
+			++k;
+		}
+
+		border[i] = k;
+	}
+
+	if(border.back() != 0) {
+		return std::string_view::npos;
+	}
+
+	return literal.find(previous);
+}
+
+} // namespace query
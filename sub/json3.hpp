@@ -2,47 +2,81 @@
 
 #include "../archive.hpp"
 #include "../config.hpp"
+#include "../events.hpp"
 #include "../util.hpp"
 
 #include <rapidjson/document.h>
 #include <unicode/uchar.h>
 #include <utf8/unchecked.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory_resource>
+#include <string>
+
 namespace sub {
 
 namespace detail {
 
-class back_insert_iterator {
+class arena_allocator { // rapidjson Allocator on top of a std::pmr::memory_resource (an arena, really), so that a DOM is a handful of allocations instead of one per value. Nothing gets freed until the arena itself goes away.
 public:
-	using difference_type = std::ptrdiff_t;
-	using iterator_category = std::output_iterator_tag;
-	using pointer = void;
-	using reference = void;
-	using value_type = void;
+	static constexpr bool kNeedFree{false};
+
+	arena_allocator() = default;
+	arena_allocator(std::pmr::memory_resource * resource): _resource{resource} {}
+
+	void * Malloc(
+		const std::size_t size
+	) {
+		return size > 0 ? _resource->allocate(size, alignof(std::max_align_t)) : nullptr;
+	}
 
-	constexpr back_insert_iterator(ashvardanian::stringzilla::string * string): _string{string} {}
+	void * Realloc(
+		void * const p
+		, const std::size_t size
+		, const std::size_t new_size
+	) {
+		if(new_size == 0) {
+			return nullptr;
+		}
+
+		if(new_size <= size) {
+			return p;
+		}
 
-	back_insert_iterator & operator =(const ashvardanian::stringzilla::string::value_type c) {_string->try_push_back(c); return *this;};
-	constexpr back_insert_iterator & operator *() {return *this;}
-	constexpr back_insert_iterator & operator ++() {return *this;}
-	constexpr back_insert_iterator & operator ++(int) {return *this;}
+		const auto _p{Malloc(new_size)};
+
+		if(p != nullptr) {
+			std::memcpy(_p, p, size);
+		}
+
+		return _p;
+	}
+
+	static void Free(void *) {}
+
+	bool operator ==(const arena_allocator &) const = default;
 
 private:
-	ashvardanian::stringzilla::string * _string;
+	std::pmr::memory_resource * _resource{std::pmr::get_default_resource()};
 };
 
 } // namespace detail
 
-template<typename T>
+inline
 bool json3(
 	decltype(archive::source::text.data) * text
-	, decltype(archive::source::timestamps.data) * timestamps
-	, T && path
+	, std::vector<events::event> * _events // See class events.
+	, decltype(archive::source::words.data) * words
+	, std::string * file // Contents of the *.json3, parsed in place (i.e. garbage afterwards).
 ) {
-	auto file{util::read<std::string>(std::forward<T>(path))};
-	rapidjson::Document json;
+	std::pmr::monotonic_buffer_resource arena{std::max<std::size_t>(2*file->size(), 4096)}; // The DOM (with ParseInsitu) takes up about twice as much as the file, so this is usually a single allocation (per file).
+	detail::arena_allocator allocator{&arena};
+	rapidjson::GenericDocument<rapidjson::UTF8<>, detail::arena_allocator, detail::arena_allocator> json{&allocator, 1024, &allocator};
 
-	json.ParseInsitu(file.data());
+	json.ParseInsitu(file->data());
 
 	if(!json.IsObject()) [[unlikely]] {
 		return false;
@@ -57,6 +91,11 @@ bool json3(
 		return false;
 	}
 
+	text->try_reserve(file->size()/8); // json3 is mostly markup, the text ends up being something like 5-10% of it. Overestimating is cheap (see try_shrink_to_fit() below), growing a byte at a time isn't.
+	_events->reserve(events->value.GetArray().Size());
+
+	thread_local std::string _utf8, lower; // Reused between segments (and files), they only ever grow to the longest segment.
+
 	for(const auto & i: events->value.GetArray()) {
 		const auto segs{i.FindMember("segs")};
 
@@ -67,7 +106,7 @@ bool json3(
 			continue; // TODO: Error.
 		}
 
-		config::timestamp_type timestamp;
+		config::timestamp_type timestamp; // Milliseconds.
 
 		{
 			const auto tStartMs{i.FindMember("tStartMs")};
@@ -79,7 +118,7 @@ bool json3(
 				continue; // TODO: Error.
 			}
 
-			timestamp = static_cast<decltype(timestamp)>(tStartMs->value.GetUint()/unsigned{1000}); // milliseconds to seconds.
+			timestamp = static_cast<decltype(timestamp)>(tStartMs->value.GetUint());
 		}
 
 		const auto begin{text->size()};
@@ -94,7 +133,7 @@ bool json3(
 				continue; // TODO: Error.
 			}
 
-			std::string _utf8{utf8->value.GetString(), utf8->value.GetStringLength()};
+			_utf8.assign(utf8->value.GetString(), utf8->value.GetStringLength());
 
 			for(const auto & skip: config::skip) {
 				for(auto j{_utf8.find(skip)}; j != _utf8.npos; j = _utf8.find(skip, j)) {
@@ -110,31 +149,45 @@ bool json3(
 
 			_utf8.resize(_utf8.size()-std::distance(_utf8.rbegin(), std::find_if_not(_utf8.rbegin(), _utf8.rend(), [](int c) {return std::isspace(c);}))); // This abomination is basically rtrim, but retarded. The reason this works (LOL) is that there's no overlap between what is considered a space (by isspace) and "trailing" UTF-8 characters, so there's no need to fuck around with UTF-16/32 or whatever.
 
+			lower.clear();
 			for(auto c{&(*left)}, end{_utf8.data()+_utf8.size()}; c < end;) {
 				auto _c{utf8::unchecked::next(c)};
 
 				_c = u_tolower(_c);
-				utf8::unchecked::utf32to8(&_c, &_c+1, detail::back_insert_iterator(text));
+				utf8::unchecked::utf32to8(&_c, &_c+1, std::back_inserter(lower));
 			}
+			lower += ' ';
 
-			text->try_append(ashvardanian::stringzilla::string_view{" "});
+			text->try_append(ashvardanian::stringzilla::string_view{lower});
 		}
 
-		constexpr auto block_size{config::timestamp_length*sizeof(config::timestamp_type)};
-
-		for(
-			auto end{text->size()}, k{util::align(begin, block_size)}
-			; k < end
-			; k += block_size
-		) {
-			timestamps->emplace_back(timestamp);
+		if(text->size() > begin) { // Events without any text (there's a lot of those, mostly "\n") don't need a timestamp.
+			_events->emplace_back(events::event{.offset = begin, .timestamp = timestamp});
 		}
 	}
 
+	words->reserve(text->size()/4);
+	util::words(std::string_view{*text}, [words](const std::size_t offset, const std::size_t) {
+		words->emplace_back(static_cast<std::uint32_t>(offset));
+	});
+
 	text->try_shrink_to_fit(); // Useless, but why not.
-	timestamps->shrink_to_fit(); // ^.
+	_events->shrink_to_fit(); // ^.
+	words->shrink_to_fit(); // ^.
 
 	return true;
 }
 
+template<typename T>
+bool json3(
+	decltype(archive::source::text.data) * text
+	, std::vector<events::event> * _events
+	, decltype(archive::source::words.data) * words
+	, T && path
+) {
+	auto file{util::read<std::string>(std::forward<T>(path))};
+
+	return json3(text, _events, words, &file);
+}
+
 } // namespace sub
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "archive.hpp"
+#include "config.hpp"
+#include "flog.hpp"
+#include "util.hpp"
+#include "word_index.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class suggest { // Sorted, front-coded dictionary of words and bigrams (with their frequencies) for autocompletion. Lives in a file and gets mmap'd, so there's nothing to load.
+public:
+	/*
+	suggest.dict:
+		"alogs\x01"
+		version                                                       // u64, archive's (see POST({"get_archive": ...})).
+		blocks.size()                                                 // u32.
+		[offset max]                                                  // u32 each, for every block: where it starts (relative to the end of this table), the highest frequency in it.
+		[                                                             // block_size terms per block, sorted.
+			varint(prefix) varint(suffix.size()) suffix varint(frequency) // prefix is the number of bytes shared with the previous term, always 0 for the first one in a block.
+		]
+
+	Fixed-size numbers are little-endian (as in "whatever the machine uses", which is little-endian).
+	*/
+
+	static constexpr std::string_view magic{"alogs\x01", 6};
+	static constexpr std::size_t block_size{16};
+
+	suggest() = default;
+
+	template<typename T>
+	suggest(
+		const T & path
+		, const std::uint64_t version // Anything else is stale.
+	):
+		_file{path}
+	{
+		const std::string_view data{_file.data(), _file.size()};
+		std::uint64_t _version;
+		std::uint32_t size;
+
+		if(
+			!data.starts_with(magic)
+			|| data.size() < magic.size()+sizeof(_version)+sizeof(size)
+		) {
+			_file = {};
+
+			return;
+		}
+
+		std::memcpy(&_version, data.data()+magic.size(), sizeof(_version));
+		std::memcpy(&size, data.data()+magic.size()+sizeof(_version), sizeof(size));
+
+		const auto table{magic.size()+sizeof(_version)+sizeof(size)};
+
+		if(
+			_version != version
+			|| data.size() < table+std::size_t{size}*2*sizeof(std::uint32_t)
+		) {
+			_file = {};
+
+			return;
+		}
+
+		_blocks = size;
+		_table = data.data()+table;
+		_data = data.substr(table+std::size_t{size}*2*sizeof(std::uint32_t));
+	}
+
+	operator bool() const {return static_cast<bool>(_file);}
+
+	static bool build( // Words come from index, bigrams get counted here (approximately, see config::suggest_bigrams_max).
+		const class archive & archive
+		, const word_index & index
+		, const std::string & path
+		, const std::uint64_t version
+	) {
+		struct hash {
+			using is_transparent = void;
+
+			std::size_t operator ()(const std::string_view x) const {return std::hash<std::string_view>{}(x);}
+		};
+
+		std::unordered_map<std::string, std::uint32_t, hash, std::equal_to<> > bigrams;
+		std::string key;
+
+		for(const auto & source: archive) {
+			const std::string_view text{source.text.data};
+			std::string_view previous;
+
+			util::words(text, [&](const std::size_t offset, const std::size_t size) {
+				const auto word{text.substr(offset, size)};
+
+				if(!previous.empty()) {
+					key.assign(previous);
+					key += ' ';
+					key += word;
+
+					if(const auto i{bigrams.find(key)}; i != bigrams.end()) {
+						++i->second;
+					} else {
+						bigrams.emplace(key, 1);
+					}
+				}
+
+				previous = word;
+			});
+
+			if(bigrams.size() > 2*config::suggest_bigrams_max) { // Keep the most frequent ones, so that memory stays bounded no matter how large the archive is. Whatever gets dropped starts over from 0 if it shows up again, so rare bigrams end up undercounted (or missing), which is fine for suggestions.
+				std::vector<std::uint32_t> counts;
+
+				counts.reserve(bigrams.size());
+				for(const auto & [_, count]: bigrams) {
+					counts.emplace_back(count);
+				}
+
+				std::nth_element(counts.begin(), counts.begin()+config::suggest_bigrams_max, counts.end(), std::greater<>{});
+
+				const auto threshold{counts[config::suggest_bigrams_max]};
+
+				std::erase_if(bigrams, [threshold](const auto & x) {return x.second <= threshold;});
+			}
+		}
+
+		std::vector<std::pair<std::string_view, std::uint32_t> > terms;
+
+		terms.reserve(index.size()+bigrams.size());
+		index.for_each([&](const std::string_view term, const std::size_t frequency) {
+			terms.emplace_back(term, static_cast<std::uint32_t>(frequency));
+		});
+		for(const auto & [bigram, count]: bigrams) {
+			if(count >= config::suggest_bigrams_min) {
+				terms.emplace_back(bigram, count);
+			}
+		}
+
+		std::sort(terms.begin(), terms.end());
+
+		std::string table, data;
+		const auto blocks{static_cast<std::uint32_t>((terms.size()+(block_size-1))/block_size)};
+
+		table.reserve(std::size_t{blocks}*2*sizeof(std::uint32_t));
+		for(std::size_t i{0}; i < terms.size(); i += block_size) {
+			const auto offset{static_cast<std::uint32_t>(data.size())};
+			std::uint32_t max{0};
+
+			for(std::size_t j{i}; j < std::min(i+block_size, terms.size()); ++j) {
+				const auto [term, frequency]{terms[j]};
+				const auto prefix{j == i ? 0 : static_cast<std::size_t>(std::mismatch(term.begin(), term.end(), terms[j-1].first.begin(), terms[j-1].first.end()).first-term.begin())};
+
+				util::varint(&data, prefix);
+				util::varint(&data, term.size()-prefix);
+				data += term.substr(prefix);
+				util::varint(&data, frequency);
+
+				max = std::max(max, frequency);
+			}
+
+			table.append(reinterpret_cast<const char *>(&offset), sizeof(offset));
+			table.append(reinterpret_cast<const char *>(&max), sizeof(max));
+		}
+
+		return util::write_atomic(path, [&](std::FILE * file) { // A torn one would pass the checks in the constructor, and then find() would read past the end.
+			return
+				std::fwrite(magic.data(), sizeof(char), magic.size(), file) == magic.size()
+				&& std::fwrite(&version, sizeof(version), 1, file) == 1
+				&& std::fwrite(&blocks, sizeof(blocks), 1, file) == 1
+				&& std::fwrite(table.data(), sizeof(char), table.size(), file) == table.size()
+				&& std::fwrite(data.data(), sizeof(char), data.size(), file) == data.size()
+			;
+		});
+	}
+
+	template<typename F>
+	void find( // f(term, frequency) for the n most frequent terms that start with prefix, most frequent first.
+		const std::string_view prefix
+		, const std::size_t n
+		, F && f
+	) const {
+		if(!*this || n == 0) {
+			return;
+		}
+
+		thread_local std::vector<std::pair<std::uint32_t, std::string> > top; // Min-heap.
+		const auto worse{[](const auto & lhs, const auto & rhs) {return lhs.first > rhs.first;}};
+
+		top.clear();
+
+		// Last block that starts before prefix, the terms we're looking for begin somewhere in it (or right after it).
+		std::size_t i{0};
+
+		for(std::size_t count{_blocks}; count > 0;) {
+			const auto step{count/2};
+
+			if(first(i+step) < prefix) {
+				i += step+1;
+				count -= step+1;
+			} else {
+				count = step;
+			}
+		}
+
+		for(i = i > 0 ? i-1 : 0; i < _blocks; ++i) {
+			if(const auto _first{first(i)}; _first > prefix && !_first.starts_with(prefix)) {
+				break; // Everything from here on is past prefix.
+			}
+
+			if(top.size() == n && max(i) <= top.front().first) {
+				continue; // Nothing in here can make it.
+			}
+
+			thread_local std::string term;
+			auto data{_data.substr(offset(i))};
+
+			term.clear();
+			for(std::size_t j{0}; j < block_size && !data.empty(); ++j) {
+				std::size_t _prefix, size;
+				std::uint32_t frequency;
+
+				if(
+					!util::varint(&data, &_prefix)
+					|| !util::varint(&data, &size)
+					|| data.size() < size
+				) [[unlikely]] {
+					return;
+				}
+
+				term.resize(_prefix);
+				term += data.substr(0, size);
+				data.remove_prefix(size);
+
+				if(!util::varint(&data, &frequency)) [[unlikely]] {
+					return;
+				}
+
+				if(!term.starts_with(prefix)) {
+					if(std::string_view{term} > prefix) {
+						break;
+					}
+
+					continue;
+				}
+
+				if(top.size() < n) {
+					top.emplace_back(frequency, term);
+					std::push_heap(top.begin(), top.end(), worse);
+				} else if(frequency > top.front().first) {
+					std::pop_heap(top.begin(), top.end(), worse);
+					top.back() = {frequency, term};
+					std::push_heap(top.begin(), top.end(), worse);
+				}
+			}
+		}
+
+		std::sort_heap(top.begin(), top.end(), worse);
+
+		for(const auto & [frequency, term]: top) {
+			f(std::string_view{term}, frequency);
+		}
+	}
+
+private:
+	std::uint32_t offset(const std::size_t block) const {std::uint32_t x; std::memcpy(&x, _table+block*2*sizeof(x), sizeof(x)); return x;}
+	std::uint32_t max(const std::size_t block) const {std::uint32_t x; std::memcpy(&x, _table+(block*2+1)*sizeof(x), sizeof(x)); return x;}
+
+	std::string_view first( // First term of a block, which is stored as is.
+		const std::size_t block
+	) const {
+		auto data{_data.substr(offset(block))};
+		std::size_t prefix, size;
+
+		if(
+			!util::varint(&data, &prefix)
+			|| !util::varint(&data, &size)
+		) [[unlikely]] {
+			return {};
+		}
+
+		return data.substr(0, size);
+	}
+
+	util::mapped_file _file;
+	std::size_t _blocks{0};
+	const char * _table{nullptr};
+	std::string_view _data;
+};
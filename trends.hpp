@@ -0,0 +1,302 @@
+#pragma once
+
+#include "archive.hpp"
+#include "config.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace trends { // Phrases (1..config::trends_ngram_max words) that got said a lot more in a particular month than usual, without knowing what to look for. Counting every n-gram exactly would take way too much memory, so it's a Count-Min sketch (fixed size, shared by all threads) instead.
+
+namespace detail {
+
+class count_min { // Count-Min sketch. Counters are updated atomically, so threads can share one.
+public:
+	static constexpr std::size_t depth_max{8};
+
+	count_min(
+		const std::size_t width // Power of 2.
+		, const std::size_t depth // Up to depth_max.
+	):
+		_mask{width-1}
+		, _depth{std::min(depth, depth_max)}
+		, _counters(width*_depth, 0)
+	{
+	}
+
+	void add(
+		const std::uint64_t key
+	) {
+		for(std::size_t i{0}; i < _depth; ++i) {
+			std::atomic_ref<std::uint32_t>{_counters[i*(_mask+1)+index(key, i)]}.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	std::uint32_t estimate( // Overestimates, never underestimates. By a lot, once there have been a lot more add()s than there are counters: every counter is mostly everyone else's.
+		const std::uint64_t key
+	) const {
+		auto result{std::numeric_limits<std::uint32_t>::max()};
+
+		for(std::size_t i{0}; i < _depth; ++i) {
+			result = std::min(result, _counters[i*(_mask+1)+index(key, i)]);
+		}
+
+		return result;
+	}
+
+	double unbiased( // Count-Mean-Min: every row's counter minus the noise it's expected to have picked up from everyone else, median of that. Not an upper bound anymore (it can even go negative for things that were never added), but it doesn't drown rare keys in noise like estimate() does.
+		const std::uint64_t key
+		, const std::uint64_t total // size(), which is too slow to call for every key.
+	) const {
+		std::array<double, depth_max> values;
+
+		for(std::size_t i{0}; i < _depth; ++i) {
+			const auto counter{_counters[i*(_mask+1)+index(key, i)]};
+
+			values[i] = static_cast<double>(counter)-static_cast<double>(total-counter)/static_cast<double>(_mask); // _mask == width-1, i.e. every other counter of the row.
+		}
+
+		std::sort(values.begin(), values.begin()+static_cast<std::ptrdiff_t>(_depth));
+
+		return std::min(
+			_depth % 2 == 1 ? values[_depth/2] : (values[_depth/2-1]+values[_depth/2])/2.0
+			, static_cast<double>(estimate(key))
+		);
+	}
+
+	std::uint64_t size( // Number of add()s so far.
+	) const {
+		std::uint64_t result{0};
+
+		for(std::size_t i{0}; i <= _mask; ++i) { // Every add() bumps exactly one counter per row.
+			result += _counters[i];
+		}
+
+		return result;
+	}
+
+private:
+	std::size_t index(
+		const std::uint64_t key
+		, const std::size_t i
+	) const {
+		const auto h{(key+i)*0x9E3779B97F4A7C15}; // Kirsch-Mitzenmacher would be cheaper, but this is simpler and the bottleneck is memory anyway.
+
+		return static_cast<std::size_t>((h ^ (h >> 29)) & _mask);
+	}
+
+	std::size_t _mask;
+	std::size_t _depth;
+	std::vector<std::uint32_t> _counters;
+};
+
+inline
+std::uint64_t key( // Of an n-gram in a bucket (0 being "all of them").
+	const std::uint64_t hash
+	, const std::size_t bucket
+) {
+	return hash ^ ((bucket+1)*0xC2B2AE3D27D4EB4F);
+}
+
+template<typename F>
+void ngrams( // f(ngram) for every 1..config::trends_ngram_max-gram in text.
+	const std::string_view text
+	, F && f
+) {
+	std::array<std::size_t, config::trends_ngram_max> begin{}; // Ring of the last words' offsets.
+	std::size_t i{0};
+
+	util::words(text, [&](const std::size_t offset, const std::size_t size) {
+		begin[i % begin.size()] = offset;
+		++i;
+
+		for(std::size_t n{1}; n <= std::min(i, begin.size()); ++n) {
+			const auto _begin{begin[(i-n) % begin.size()]};
+
+			f(text.substr(_begin, (offset+size)-_begin));
+		}
+	});
+}
+
+inline
+std::size_t threads_size(
+) {
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+template<typename F>
+void parallel( // f(source, bucket, thread) for every source, split between threads_size() threads.
+	const class archive & archive
+	, const std::vector<std::size_t> & buckets
+	, F && f
+) {
+	std::vector<std::thread> threads;
+	const auto _threads_size{threads_size()};
+	std::atomic<std::size_t> next{0}; // Sources differ in size quite a bit, so it's one at a time instead of equal chunks.
+
+	threads.reserve(_threads_size);
+	for(std::size_t i{0}; i < _threads_size; ++i) {
+		threads.emplace_back([&, i] {
+			for(std::size_t j; (j = next.fetch_add(1, std::memory_order_relaxed)) < archive.size();) {
+				f(archive[j], buckets[j], i);
+			}
+		});
+	}
+
+	for(auto & i: threads) {
+		i.join();
+	}
+}
+
+} // namespace detail
+
+inline
+std::string find( // Returns the JSON served by POST({"trends": ...}).
+	const class archive & archive
+	, const std::size_t version
+) {
+	/*
+	{
+		"version": Number
+		, "months": [
+			{
+				"m": Number     // First day of the month (seconds since epoch)
+				, "words": Number
+				, "top": [
+					{
+						"p": String   // Phrase
+						, "c": Number // Count (approximate, with the sketch's expected noise taken out)
+						, "l": Number // Lift, i.e. how many times more often it was said that month compared to the entire archive
+					}
+				]
+			}
+		]
+	}
+	*/
+
+	using namespace std::chrono;
+
+	std::vector<std::int64_t> months; // Bucket (minus one) -> first day of the month.
+	std::vector<std::size_t> buckets(archive.size()); // Source -> bucket.
+
+	for(std::size_t i{0}; const auto & source: archive) {
+		const year_month_day ymd{sys_days{days{source.upload_date/(24*60*60)}}};
+		const auto month{static_cast<std::int64_t>(duration_cast<seconds>(sys_days{ymd.year()/ymd.month()/1}.time_since_epoch()).count())};
+
+		if(months.empty() || months.back() != month) { // Sources are sorted by upload_date, so months are contiguous.
+			months.emplace_back(month);
+		}
+
+		buckets[i++] = months.size();
+	}
+
+	detail::count_min sketch{config::trends_sketch_width, config::trends_sketch_depth};
+	std::vector<std::size_t> words(months.size()+1, 0); // Per bucket.
+
+	for(std::size_t i{0}; const auto & source: archive) {
+		words[buckets[i]] += source.words.data.size();
+		words[0] += source.words.data.size();
+		++i;
+	}
+
+	detail::parallel(archive, buckets, [&](const archive::source & source, const std::size_t bucket, const std::size_t) {
+		detail::ngrams(std::string_view{source.text.data}, [&](const std::string_view ngram) {
+			const auto hash{std::hash<std::string_view>{}(ngram)};
+
+			sketch.add(detail::key(hash, 0));
+			sketch.add(detail::key(hash, bucket));
+		});
+	});
+
+	struct candidate {
+		double score; // count*log(lift), i.e. the phrase's contribution to the KL divergence between the month and everything else.
+		std::uint32_t count;
+		double lift;
+	};
+
+	struct candidates { // Per bucket.
+		std::unordered_map<std::string_view, candidate> top; // At most config::trends_top. string_views point into archive::source::text.
+		double min{0.0}; // Lowest score in top (once it's full). Lives as long as top does, since a thread gets to see many sources of the same bucket.
+	};
+
+	std::vector<std::vector<candidates> > _candidates(detail::threads_size(), std::vector<candidates>(months.size()+1)); // Per thread, per bucket.
+
+	const auto total{sketch.size()};
+
+	detail::parallel(archive, buckets, [&](const archive::source & source, const std::size_t bucket, const std::size_t thread) { // Now that the counts are final, pick the best candidates.
+		auto & [__candidates, min]{_candidates[thread][bucket]};
+
+		detail::ngrams(std::string_view{source.text.data}, [&](const std::string_view ngram) { // Both counts are unbiased() rather than estimate()d: with a few hundred million n-grams in the sketch every counter has a few hundred of noise in it, which is more than most phrases get said in a month, and the lift of pure noise is (about) the number of months.
+			const auto hash{std::hash<std::string_view>{}(ngram)};
+			const auto count{sketch.unbiased(detail::key(hash, bucket), total)};
+
+			if(count < config::trends_min_count) {
+				return;
+			}
+
+			const auto lift{(count/static_cast<double>(words[bucket]))/(std::max(sketch.unbiased(detail::key(hash, 0), total), count)/static_cast<double>(words[0]))}; // Noise can make the whole archive look like less than one of its months.
+			const auto score{count*std::log(lift)};
+
+			if(
+				score <= 0.0
+				|| (__candidates.size() >= config::trends_top && score <= min)
+				|| __candidates.contains(ngram)
+			) {
+				return;
+			}
+
+			if(__candidates.size() >= config::trends_top) {
+				__candidates.erase(std::min_element(__candidates.begin(), __candidates.end(), [](const auto & lhs, const auto & rhs) {return lhs.second.score < rhs.second.score;}));
+			}
+
+			__candidates.emplace(ngram, candidate{.score = score, .count = static_cast<std::uint32_t>(std::lround(count)), .lift = lift});
+
+			if(__candidates.size() >= config::trends_top) {
+				min = std::min_element(__candidates.begin(), __candidates.end(), [](const auto & lhs, const auto & rhs) {return lhs.second.score < rhs.second.score;})->second.score;
+			}
+		});
+	});
+
+	std::string json;
+
+	util::strcat(&json, "{\"version\":", version, ",\"months\":[");
+	for(std::size_t i{1}; i <= months.size(); ++i) {
+		std::vector<std::pair<std::string_view, candidate> > top;
+
+		for(const auto & j: _candidates) {
+			for(const auto & k: j[i].top) {
+				if(std::find_if(top.begin(), top.end(), [&](const auto & x) {return x.first == k.first;}) == top.end()) {
+					top.emplace_back(k);
+				}
+			}
+		}
+
+		std::sort(top.begin(), top.end(), [](const auto & lhs, const auto & rhs) {return lhs.second.score > rhs.second.score;});
+		top.resize(std::min<std::size_t>(top.size(), config::trends_top));
+
+		util::strcat(&json, i > 1 ? "," : "", "{\"m\":", months[i-1], ",\"words\":", words[i], ",\"top\":[");
+		for(char separator{' '}; const auto & [phrase, candidate]: top) {
+			util::strcat(&json, separator, "{\"p\":\"", util::json_escaped{phrase}, "\",\"c\":", candidate.count, ",\"l\":", util::format("%.2f", candidate.lift), '}');
+
+			separator = ',';
+		}
+		json += "]}";
+	}
+	json += "]}";
+
+	return json;
+}
+
+} // namespace trends
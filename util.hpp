@@ -1,14 +1,44 @@
 #pragma once
 
 #include <array>
+#include <bit>
 #include <cassert>
+#include <charconv>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#endif // __SSE2__
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+
+#ifdef GetObject
+#undef GetObject // Same as in main.cpp, rapidjson has a GetObject of its own.
+#endif // GetObject
+#else // !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
 
 namespace util {
 
@@ -36,6 +66,13 @@ const auto * data(
 	}
 }
 
+struct json_escaped { // strcat(&s, json_escaped{x}) appends x escaped for use inside of a JSON string.
+	std::string_view string;
+};
+
+template<typename T>
+concept integer = std::is_integral_v<std::remove_cvref_t<T> > && !std::is_same_v<std::remove_cvref_t<T>, char> && !std::is_same_v<std::remove_cvref_t<T>, bool>;
+
 template<typename T>
 constexpr
 auto strlen(
@@ -45,11 +82,90 @@ auto strlen(
 		return x.size();
 	} else if constexpr(std::is_same_v<std::remove_cvref_t<T>, char>) {
 		return sizeof(char);
+	} else if constexpr(std::is_same_v<std::remove_cvref_t<T>, json_escaped>) {
+		return x.string.size(); // Lower bound, which is good enough for reserve().
+	} else if constexpr(integer<T>) {
+		return static_cast<std::size_t>(std::numeric_limits<std::remove_cvref_t<T> >::digits10+2); // Upper bound (sign included).
 	} else {
 		return std::string_view{std::forward<T>(x)}.size();
 	}
 }
 
+inline
+const char * json_escape_find( // Returns a pointer to the first character in [begin, end) that has to be escaped (or end).
+	const char * begin
+	, const char * const end
+) {
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+	const auto
+		quote{_mm_set1_epi8('"')}
+		, backslash{_mm_set1_epi8('\\')}
+		, control{_mm_set1_epi8(0x1F)}
+	;
+
+	for(; end-begin >= 16; begin += 16) {
+		const auto x{_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin))};
+		const auto mask{_mm_movemask_epi8(_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash))
+			, _mm_cmpeq_epi8(_mm_max_epu8(x, control), control) // x <= 0x1F (unsigned).
+		))};
+
+		if(mask != 0) {
+			return begin+std::countr_zero(static_cast<unsigned>(mask));
+		}
+	}
+#endif // __SSE2__
+
+	for(; begin < end; ++begin) {
+		if(
+			*begin == '"'
+			|| *begin == '\\'
+			|| static_cast<unsigned char>(*begin) < 0x20
+		) {
+			break;
+		}
+	}
+
+	return begin;
+}
+
+inline
+void json_escape(
+	std::string * s
+	, const std::string_view x
+) {
+	const auto * end{x.data()+x.size()};
+
+	for(const auto * i{x.data()};;) {
+		const auto * j{json_escape_find(i, end)};
+
+		s->append(i, j);
+
+		if(j == end) {
+			break;
+		}
+
+		switch(*j) {
+			case '"': s->append("\\\""); break;
+			case '\\': s->append("\\\\"); break;
+			case '\b': s->append("\\b"); break;
+			case '\f': s->append("\\f"); break;
+			case '\n': s->append("\\n"); break;
+			case '\r': s->append("\\r"); break;
+			case '\t': s->append("\\t"); break;
+			default: {
+				static constexpr std::string_view hex{"0123456789abcdef"};
+
+				s->append("\\u00");
+				*s += hex[static_cast<unsigned char>(*j)>>4];
+				*s += hex[static_cast<unsigned char>(*j) & 0xF];
+			}
+		}
+
+		i = j+1;
+	}
+}
+
 template<typename T, typename ... _T>
 constexpr
 std::size_t strcat(
@@ -65,12 +181,187 @@ std::size_t strcat(
 	s->reserve(size);
 
 	([&] {
-		*s += argv;
+		if constexpr(std::is_same_v<std::remove_cvref_t<_T>, json_escaped>) {
+			json_escape(s, argv.string);
+		} else if constexpr(integer<_T>) {
+			std::array<char, strlen(std::remove_cvref_t<_T>{})> buffer;
+
+			*s += std::string_view{buffer.data(), std::to_chars(buffer.data(), buffer.data()+buffer.size(), argv).ptr};
+		} else {
+			*s += argv;
+		}
 	}(), ...);
 
 	return size;
 }
 
+template<typename T> requires std::is_unsigned_v<T>
+constexpr
+void varint( // Unsigned LEB128.
+	std::string * s
+	, T x
+) {
+	for(; x >= 0x80; x >>= 7) {
+		*s += static_cast<char>((x & 0x7F) | 0x80);
+	}
+	*s += static_cast<char>(x);
+}
+
+template<typename T> requires std::is_unsigned_v<T>
+constexpr
+bool varint( // Reads what varint(std::string *, x) wrote, advancing s past it. Returns false if s is truncated (or just garbage).
+	std::string_view * s
+	, T * x
+) {
+	*x = 0;
+
+	for(unsigned shift{0}; shift < sizeof(T)*8; shift += 7) {
+		if(s->empty()) [[unlikely]] {
+			return false;
+		}
+
+		const auto c{static_cast<unsigned char>(s->front())};
+
+		s->remove_prefix(1);
+		*x |= static_cast<T>(static_cast<T>(c & 0x7F) << shift);
+
+		if((c & 0x80) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template<typename T> requires std::is_signed_v<T>
+constexpr
+auto zigzag( // Maps signed integers to unsigned ones so that small magnitudes stay small (for varint()).
+	const T x
+) {
+	using U = std::make_unsigned_t<T>;
+
+	return static_cast<U>(static_cast<U>(x) << 1) ^ static_cast<U>(x >> (sizeof(T)*8-1));
+}
+
+template<typename F>
+constexpr
+void words( // f(offset, size) for every word (run of non-whitespace characters) in text, which is all the tokenization normalized subs need.
+	const std::string_view text
+	, F && f
+) {
+	constexpr auto space{[](const char c) {return c == ' ' || (c >= '\t' && c <= '\r');}};
+
+	for(std::size_t i{0}; i < text.size();) {
+		for(; i < text.size() && space(text[i]); ++i) {
+		}
+
+		const auto begin{i};
+
+		for(; i < text.size() && !space(text[i]); ++i) {
+		}
+
+		if(i > begin) {
+			f(begin, i-begin);
+		}
+	}
+}
+
+constexpr
+std::uint64_t fnv1a( // Not cryptographic (or particularly good), but it's stable across platforms/runs, which is all we need for naming files.
+	const std::string_view s
+) {
+	std::uint64_t hash{0xCBF29CE484222325};
+
+	for(const auto c: s) {
+		hash = (hash ^ static_cast<unsigned char>(c))*0x100000001B3;
+	}
+
+	return hash;
+}
+
+inline
+std::uint64_t xxh64( // XXH64, for when there's a lot more to hash than a file name (several GB/s vs. fnv1a()'s few hundred MB/s). Assumes little-endian, as does everything else.
+	const std::string_view s
+	, const std::uint64_t seed = 0
+) {
+	constexpr std::uint64_t
+		p1{0x9E3779B185EBCA87}
+		, p2{0xC2B2AE3D27D4EB4F}
+		, p3{0x165667B19E3779F9}
+		, p4{0x85EBCA77C2B2AE63}
+		, p5{0x27D4EB2F165667C5}
+	;
+	const auto load{[]<typename T>(const char * p, T x) {std::memcpy(&x, p, sizeof(x)); return x;}};
+	const auto round{[](const std::uint64_t acc, const std::uint64_t x) {return std::rotl(acc+x*p2, 31)*p1;}};
+	auto p{s.data()};
+	const auto end{s.data()+s.size()};
+	std::uint64_t hash;
+
+	if(s.size() >= 32) {
+		std::uint64_t v[4]{seed+p1+p2, seed+p2, seed, seed-p1};
+
+		for(; end-p >= 32; p += 32) {
+			for(std::size_t i{0}; i < 4; ++i) {
+				v[i] = round(v[i], load(p+i*8, std::uint64_t{}));
+			}
+		}
+
+		hash = std::rotl(v[0], 1)+std::rotl(v[1], 7)+std::rotl(v[2], 12)+std::rotl(v[3], 18);
+		for(const auto i: v) {
+			hash = (hash ^ round(0, i))*p1+p4;
+		}
+	} else {
+		hash = seed+p5;
+	}
+
+	hash += s.size();
+
+	for(; end-p >= 8; p += 8) {
+		hash = std::rotl(hash ^ round(0, load(p, std::uint64_t{})), 27)*p1+p4;
+	}
+	if(end-p >= 4) {
+		hash = std::rotl(hash ^ (std::uint64_t{load(p, std::uint32_t{})}*p1), 23)*p2+p3;
+		p += 4;
+	}
+	for(; p < end; ++p) {
+		hash = std::rotl(hash ^ (std::uint64_t{static_cast<unsigned char>(*p)}*p5), 11)*p1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= p2;
+	hash ^= hash >> 29;
+	hash *= p3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+inline
+std::string & thread_buffer( // Per-thread output buffer, so that we don't have to reallocate the entire response on every request. Cleared on every call, so don't hold on to it.
+) {
+	thread_local std::string buffer;
+
+	buffer.clear(); // Keeps the capacity.
+
+	return buffer;
+}
+
+template<typename T>
+class shrink_on_exit { // Gives a reused (thread_local) buffer's memory back at the end of the scope if it grew past size_max elements, so that one huge request doesn't pin it for the rest of the thread's life.
+public:
+	shrink_on_exit(T & buffer, const std::size_t size_max): _buffer{buffer}, _size_max{size_max} {}
+	~shrink_on_exit() {if(capacity() > _size_max) [[unlikely]] {T{}.swap(_buffer);}}
+
+	shrink_on_exit(const shrink_on_exit &) = delete;
+	shrink_on_exit & operator =(const shrink_on_exit &) = delete;
+
+private:
+	std::size_t capacity() const {if constexpr(requires {_buffer.capacity();}) {return _buffer.capacity();} else {return _buffer.bucket_count();}} // Hash tables don't have a capacity, but their buckets are what's left over.
+
+	T & _buffer;
+	std::size_t _size_max;
+};
+
 class file { // Just a simple RAII wrapper, because dealing with fclose is a PITA.
 public:
 	constexpr file() = default;
@@ -89,6 +380,413 @@ private:
 	std::FILE * _file{nullptr};
 };
 
+class mapped_file { // Read-only memory mapping of an entire file, for things we only ever look at a few pages of.
+public:
+	constexpr mapped_file() = default;
+
+	template<typename T>
+	explicit mapped_file(
+		const T & path
+	) {
+#ifdef _WIN32
+		std::wstring _path(static_cast<std::size_t>(MultiByteToWideChar(CP_UTF8, 0, c_str(path), -1, nullptr, 0)), L'\0'); // The paths are UTF-8, and *A() functions don't care about our setlocale.
+
+		MultiByteToWideChar(CP_UTF8, 0, c_str(path), -1, _path.data(), static_cast<int>(_path.size()));
+
+		const auto file{CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)};
+
+		if(file == INVALID_HANDLE_VALUE) [[unlikely]] {
+			return;
+		}
+
+		if(LARGE_INTEGER size; GetFileSizeEx(file, &size) && size.QuadPart > 0) [[likely]] {
+			if(const auto mapping{CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)}; mapping != nullptr) [[likely]] {
+				_data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				_size = _data != nullptr ? static_cast<std::size_t>(size.QuadPart) : 0;
+
+				CloseHandle(mapping); // The view keeps it alive.
+			}
+		}
+
+		CloseHandle(file);
+#else // !_WIN32
+		const auto file{open(c_str(path), O_RDONLY)};
+
+		if(file == -1) [[unlikely]] {
+			return;
+		}
+
+		if(struct stat stat; fstat(file, &stat) == 0 && stat.st_size > 0) [[likely]] {
+			if(const auto data{mmap(nullptr, static_cast<std::size_t>(stat.st_size), PROT_READ, MAP_SHARED, file, 0)}; data != MAP_FAILED) [[likely]] {
+				_data = static_cast<const char *>(data);
+				_size = static_cast<std::size_t>(stat.st_size);
+			}
+		}
+
+		close(file); // The mapping keeps it alive.
+#endif // _WIN32
+	}
+
+	~mapped_file() {
+		if(_data != nullptr) {
+#ifdef _WIN32
+			UnmapViewOfFile(_data);
+#else // !_WIN32
+			munmap(const_cast<char *>(_data), _size);
+#endif // _WIN32
+		}
+	}
+
+	mapped_file(const mapped_file &) = delete;
+	constexpr mapped_file(mapped_file && other): _data{other._data}, _size{other._size} {other._data = nullptr; other._size = 0;}
+	mapped_file & operator =(const mapped_file &) = delete;
+	constexpr mapped_file & operator =(mapped_file && rhs) {std::swap(_data, rhs._data); std::swap(_size, rhs._size); return *this;}
+
+	constexpr operator bool() const {return _data != nullptr;}
+	constexpr const char * data() const {return _data;}
+	constexpr std::size_t size() const {return _size;}
+
+private:
+	const char * _data{nullptr};
+	std::size_t _size{0};
+};
+
+template<typename T>
+class queue { // Bounded, blocking, multi-producer/multi-consumer. Keeps track of how long everyone's been waiting, which is how you find the bottleneck of a pipeline: whoever's waiting on push() is too fast, whoever's waiting on pop() is starved.
+public:
+	explicit queue(
+		const std::size_t capacity
+	):
+		_capacity{capacity}
+	{
+	}
+
+	bool push( // Blocks while full. Returns false (and drops x) if the queue has been closed.
+		T && x
+	) {
+		std::unique_lock lock{_mutex};
+
+		if(_items.size() >= _capacity && !_closed) {
+			const auto t{std::chrono::steady_clock::now()};
+
+			_not_full.wait(lock, [this] {return _items.size() < _capacity || _closed;});
+			_push_wait += std::chrono::steady_clock::now()-t;
+		}
+
+		if(_closed) [[unlikely]] {
+			return false;
+		}
+
+		_items.emplace_back(std::move(x));
+		lock.unlock();
+		_not_empty.notify_one();
+
+		return true;
+	}
+
+	std::optional<T> pop( // Blocks while empty. Returns nullopt once the queue has been closed *and* drained.
+	) {
+		std::unique_lock lock{_mutex};
+
+		if(_items.empty() && !_closed) {
+			const auto t{std::chrono::steady_clock::now()};
+
+			_not_empty.wait(lock, [this] {return !_items.empty() || _closed;});
+			_pop_wait += std::chrono::steady_clock::now()-t;
+		}
+
+		if(_items.empty()) {
+			return std::nullopt;
+		}
+
+		std::optional<T> x{std::move(_items.front())};
+
+		_items.pop_front();
+		lock.unlock();
+		_not_full.notify_one();
+
+		return x;
+	}
+
+	void close( // No more push()es, pop() drains whatever's left.
+	) {
+		{
+			std::lock_guard lock{_mutex};
+
+			_closed = true;
+		}
+
+		_not_full.notify_all();
+		_not_empty.notify_all();
+	}
+
+	std::chrono::steady_clock::duration push_wait() const {std::lock_guard lock{_mutex}; return _push_wait;} // Total, across all producers.
+	std::chrono::steady_clock::duration pop_wait() const {std::lock_guard lock{_mutex}; return _pop_wait;} // ^, consumers.
+
+private:
+	std::size_t _capacity;
+	std::deque<T> _items;
+	bool _closed{false};
+	mutable std::mutex _mutex;
+	std::condition_variable _not_full;
+	std::condition_variable _not_empty;
+	std::chrono::steady_clock::duration _push_wait{0};
+	std::chrono::steady_clock::duration _pop_wait{0};
+};
+
+class pool { // Fixed set of threads, shared by whoever needs them. Every run() is a batch of its own, and idle threads take turns between batches (one item at a time), so a batch with a lot of (or a lot of slow) work can't starve the ones that show up after it.
+public:
+	explicit pool(
+		const std::size_t threads
+	) {
+		_threads.reserve(threads);
+		for(std::size_t i{0}; i < threads; ++i) {
+			_threads.emplace_back([this] {
+				std::unique_lock lock{_mutex};
+
+				for(;;) {
+					_not_empty.wait(lock, [this] {return !_batches.empty() || _closed;});
+
+					if(_batches.empty()) { // Closed.
+						return;
+					}
+
+					work(_batches.front(), lock);
+				}
+			});
+		}
+	}
+
+	~pool() {
+		{
+			std::lock_guard lock{_mutex};
+
+			_closed = true;
+		}
+
+		_not_empty.notify_all();
+
+		for(auto & i: _threads) {
+			i.join();
+		}
+	}
+
+	pool(const pool &) = delete;
+	pool & operator =(const pool &) = delete;
+
+	template<typename F>
+	void run( // f(i) for every i < size, returns once all of them are done. The calling thread works on its own batch too, so this makes progress even if every thread in the pool is busy (or if it gets called from one of them).
+		const std::size_t size
+		, F && f
+	) {
+		if(size == 0) {
+			return;
+		}
+
+		batch _batch{.size = size, .f = [&f](const std::size_t i) {f(i);}};
+		std::unique_lock lock{_mutex};
+
+		_batches.emplace_back(&_batch);
+		_not_empty.notify_all();
+
+		while(_batch.next < _batch.size) {
+			work(&_batch, lock);
+		}
+
+		_done.wait(lock, [&_batch] {return _batch.done == _batch.size;});
+	}
+
+private:
+	struct batch {
+		std::size_t size;
+		std::function<void(std::size_t)> f;
+		std::size_t next{0}; // Next item to hand out.
+		std::size_t done{0};
+	};
+
+	void work( // Runs the next item of a batch, which then goes to the back of the line (or out of it, if that was its last one). Called (and returns) with lock held.
+		batch * const _batch
+		, std::unique_lock<std::mutex> & lock
+	) {
+		const auto i{_batch->next++};
+
+		std::erase(_batches, _batch);
+		if(_batch->next < _batch->size) {
+			_batches.emplace_back(_batch);
+		}
+
+		lock.unlock();
+		_batch->f(i);
+		lock.lock();
+
+		if(++_batch->done == _batch->size) {
+			_done.notify_all();
+		}
+	}
+
+	std::deque<batch *> _batches; // The ones with items left to hand out.
+	bool _closed{false};
+	std::mutex _mutex;
+	std::condition_variable _not_empty;
+	std::condition_variable _done;
+	std::vector<std::thread> _threads;
+};
+
+class elias_fano { // Non-decreasing sequence of integers in about 2+log2(max/size) bits each, with O(1) access and (practically) O(1) lower_bound().
+public:
+	static constexpr std::size_t quantum{256}; // Every quantum'th 1 (and 0) of _high gets sampled, see select().
+
+	elias_fano() = default;
+
+	elias_fano(
+		const std::span<const std::uint64_t> values // Non-decreasing.
+	):
+		_size{values.size()}
+	{
+		if(values.empty()) {
+			return;
+		}
+
+		const auto universe{values.back()+1};
+
+		_low_bits = universe > _size ? static_cast<unsigned>(std::bit_width(universe/_size)-1) : 0;
+		_low.assign((_size*_low_bits+63)/64+1, 0); // +1 so that low() can always read two words.
+		_high.assign((_size+(values.back() >> _low_bits)+1+63)/64, 0); // There's always at least one 0 after the last 1, which lower_bound() relies on.
+
+		for(std::size_t i{0}; i < _size; ++i) {
+			if(_low_bits > 0) {
+				const auto low{values[i] & ((std::uint64_t{1} << _low_bits)-1)};
+				const auto bit{i*_low_bits};
+
+				_low[bit/64] |= low << (bit % 64);
+				if(bit % 64+_low_bits > 64) {
+					_low[bit/64+1] |= low >> (64-bit % 64);
+				}
+			}
+
+			const auto bit{(values[i] >> _low_bits)+i};
+
+			_high[bit/64] |= std::uint64_t{1} << (bit % 64);
+		}
+
+		for(std::size_t ones{0}, zeros{0}, bit{0}; bit < _high.size()*64; ++bit) {
+			if((_high[bit/64] >> (bit % 64)) & 1) {
+				if(ones++ % quantum == 0) {
+					_samples[1].emplace_back(static_cast<std::uint32_t>(bit));
+				}
+			} else if(zeros++ % quantum == 0) {
+				_samples[0].emplace_back(static_cast<std::uint32_t>(bit));
+			}
+		}
+	}
+
+	std::size_t size() const {return _size;}
+	bool empty() const {return _size == 0;}
+
+	std::uint64_t operator [](
+		const std::size_t i
+	) const {
+		return ((select<1>(i)-i) << _low_bits) | low(i);
+	}
+
+	std::size_t lower_bound( // Index of the first value >= x, size() if there's none.
+		const std::uint64_t x
+	) const {
+		const auto high{x >> _low_bits};
+		std::size_t bit{0}, i{0};
+
+		if(high > 0) {
+			if(high-1 >= _high.size()*64-_size) { // More 0s than there are.
+				return _size;
+			}
+
+			bit = select<0>(high-1)+1;
+			i = bit-high; // Number of 1s before bit, i.e. values whose high part is < high.
+		}
+
+		for(; i < _size; ++bit) {
+			if(!((_high[bit/64] >> (bit % 64)) & 1)) {
+				break; // Everything from here on has a higher high part, so it's > x.
+			}
+
+			if((((bit-i) << _low_bits) | low(i)) >= x) {
+				return i;
+			}
+
+			++i;
+		}
+
+		return i;
+	}
+
+	std::size_t bytes() const {return (_low.size()+_high.size())*sizeof(std::uint64_t)+(_samples[0].size()+_samples[1].size())*sizeof(std::uint32_t);}
+
+private:
+	std::uint64_t low(
+		const std::size_t i
+	) const {
+		if(_low_bits == 0) {
+			return 0;
+		}
+
+		const auto bit{i*_low_bits};
+		auto x{_low[bit/64] >> (bit % 64)};
+
+		if(bit % 64+_low_bits > 64) {
+			x |= _low[bit/64+1] << (64-bit % 64);
+		}
+
+		return x & ((std::uint64_t{1} << _low_bits)-1);
+	}
+
+	template<int B>
+	std::size_t select( // Position (in _high) of the i'th B.
+		std::size_t i
+	) const {
+		auto bit{std::size_t{_samples[B][i/quantum]}};
+
+		i %= quantum;
+
+		auto word{(B == 1 ? _high[bit/64] : ~_high[bit/64]) & (~std::uint64_t{0} << (bit % 64))};
+
+		for(bit -= bit % 64;; bit += 64) {
+			if(const auto size{static_cast<std::size_t>(std::popcount(word))}; i < size) {
+				break;
+			} else {
+				i -= size;
+			}
+
+			word = B == 1 ? _high[bit/64+1] : ~_high[bit/64+1];
+		}
+
+		for(; i > 0; --i) {
+			word &= word-1;
+		}
+
+		return bit+static_cast<std::size_t>(std::countr_zero(word));
+	}
+
+	std::size_t _size{0};
+	unsigned _low_bits{0};
+	std::vector<std::uint64_t> _low; // Packed, _low_bits each.
+	std::vector<std::uint64_t> _high; // Unary, the i'th value sets bit (value >> _low_bits)+i.
+	std::vector<std::uint32_t> _samples[2]; // [B][j] is the position of the (j*quantum)'th B in _high.
+};
+
+template<typename T> requires requires(T x) {x.resize({});}
+bool resize( // Because StringZilla doesn't have a *_NO_EXCEPTIONS (or equivalent). And since we're here we might as well check the result (despite the fact that it'll (probably) never be false).
+	T * x
+	, const std::size_t size
+) {
+	if constexpr(requires {x->try_resize({});}) {
+		return x->try_resize(size);
+	} else {
+		x->resize(size);
+
+		return true;
+	}
+}
+
 template<typename T, typename _T> requires (
 	std::ranges::contiguous_range<T>
 	&& !std::is_same_v<typename T::value_type, void>
@@ -96,31 +794,49 @@ template<typename T, typename _T> requires (
 	&& requires(T x) {x.data();}
 	&& requires(T x) {x.size();}
 )
-auto read(
+bool read( // Same as below, except that a missing file is distinguishable from an empty one.
 	const _T & path
+	, T * result
 ) {
 	file file{c_str(path), "rb"};
 
 	if(!file) [[unlikely]] {
-		return T{};
+		return false;
 	}
 
-	T result;
-
 	std::fseek(static_cast<std::FILE *>(file), 0, SEEK_END);
-	if constexpr(requires {result.try_resize({});}) { // Because StringZilla doesn't have a *_NO_EXCEPTIONS (or equivalent). And since we're here we might as well check the result (despite the fact that it'll (probably) never be false).
-		if(!result.try_resize(std::ftell(static_cast<std::FILE *>(file))/sizeof(typename T::value_type))) [[unlikely]] {
-			return T{}; // We have no idea what state "result" is in after a failed allocation. Not that it matters, because if we've managed to get here somehow, we got bigger problems.
-		}
-	} else {
-		result.resize(std::ftell(static_cast<std::FILE *>(file))/sizeof(typename T::value_type));
+	if(!resize(result, std::ftell(static_cast<std::FILE *>(file))/sizeof(typename T::value_type))) [[unlikely]] {
+		*result = T{}; // We have no idea what state "result" is in after a failed allocation. Not that it matters, because if we've managed to get here somehow, we got bigger problems.
+
+		return false;
 	}
 	std::rewind(static_cast<std::FILE *>(file));
 
 	if(
-		std::fread(result.data(), sizeof(typename T::value_type), result.size(), static_cast<std::FILE *>(file))
-		!= result.size()
+		std::fread(result->data(), sizeof(typename T::value_type), result->size(), static_cast<std::FILE *>(file))
+		!= result->size()
 	) [[unlikely]] {
+		*result = T{};
+
+		return false;
+	}
+
+	return true;
+}
+
+template<typename T, typename _T> requires (
+	std::ranges::contiguous_range<T>
+	&& !std::is_same_v<typename T::value_type, void>
+	&& requires(T x) {x.resize({});}
+	&& requires(T x) {x.data();}
+	&& requires(T x) {x.size();}
+)
+auto read(
+	const _T & path
+) {
+	T result;
+
+	if(!read(path, &result)) [[unlikely]] {
 		return T{}; // Okay mom, I'm not ignoring the result. A lot of good will that do if the system is fucked enough to somehow fail an fread. TODO: Of course, the result.size() (or result.empty()) *must* be checked now, but I'm obviously not going to do that and just let the thing segfault in case we actually get here.
 	}
 
@@ -151,49 +867,79 @@ bool write(
 	) == data.size()*sizeof(typename T::value_type);
 }
 
-template<typename T> requires std::is_integral_v<T> && std::is_unsigned_v<T>
-constexpr
-T align
-(
-	const T x
-	, const T n
+inline
+bool sync( // Makes sure whatever's been written to file has actually made it to the disk (as far as the OS can tell, anyway), not just to the page cache.
+	std::FILE * file
 ) {
-	return n*((x+(n-T{1}))/n);
+	if(std::fflush(file) != 0) [[unlikely]] {
+		return false;
+	}
+
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else // !_WIN32
+	return ::fsync(::fileno(file)) == 0;
+#endif // _WIN32
 }
 
-constexpr
-void json_escape(
-	std::string * s
-	, const char c
+template<typename T> requires requires(T x) {c_str(x);}
+bool sync( // Same, by path, for files that have been written (and closed) already. Also works for directories, which is what makes a rename() durable.
+	const T & path
 ) {
-	for(auto j{s->find(c)}; j != s->npos; j = s->find(c, j+strlen("\\")+1)) {
-		s->replace(j, 1, std::string{'\\'}+c);
+#ifdef _WIN32
+	std::wstring _path(static_cast<std::size_t>(MultiByteToWideChar(CP_UTF8, 0, c_str(path), -1, nullptr, 0)), L'\0');
+
+	MultiByteToWideChar(CP_UTF8, 0, c_str(path), -1, _path.data(), static_cast<int>(_path.size()));
+
+	if(const auto attributes{GetFileAttributesW(_path.c_str())}; attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		return true; // Can't open one with fopen(), and NTFS doesn't need it anyway.
 	}
+
+	file file{c_str(path), "r+b"}; // _commit() wants write access.
+
+	return file && sync(static_cast<std::FILE *>(file));
+#else // !_WIN32
+	const auto fd{::open(c_str(path), O_RDONLY | O_CLOEXEC)};
+
+	if(fd < 0) [[unlikely]] {
+		return false;
+	}
+
+	const auto result{::fsync(fd) == 0};
+
+	::close(fd);
+
+	return result;
+#endif // _WIN32
 }
 
+template<typename T> requires std::is_integral_v<T> && std::is_unsigned_v<T>
 constexpr
-std::string json_escape(
-	std::string s
+T align
+(
+	const T x
+	, const T n
 ) {
-	json_escape(&s, '\\');
-	json_escape(&s, '"');
-
-	return s;
+	return n*((x+(n-T{1}))/n);
 }
 
 template<typename T> requires requires(T x) {c_str(x);}
-bool file_exists(
+bool file_exists( // Regular files only, directories (which is something that happens, apparently) don't count.
 	const T & path
 ) {
-	auto file{std::fopen(c_str(path), "r+")}; // The "+" is spooky, but it prevents false positives when trying to open a directory (which is something that happens, apparently).
+#ifdef _WIN32
+	std::wstring _path(static_cast<std::size_t>(MultiByteToWideChar(CP_UTF8, 0, c_str(path), -1, nullptr, 0)), L'\0');
 
-	if(file == nullptr) [[unlikely]] { // Is it, though?
-		return false;
-	}
+	MultiByteToWideChar(CP_UTF8, 0, c_str(path), -1, _path.data(), static_cast<int>(_path.size()));
 
-	std::fclose(file);
+	const auto attributes{GetFileAttributesW(_path.c_str())};
 
-	return true;
+	return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else // !_WIN32
+	struct stat _stat; // Used to be fopen+fclose, which is two syscalls (and a FILE) more than it takes.
+
+	return ::stat(c_str(path), &_stat) == 0 && S_ISREG(_stat.st_mode);
+#endif // _WIN32
 }
 
 consteval
@@ -212,6 +958,44 @@ auto path_separators(
 
 consteval auto path_separator() {return path_separators().front();}
 
+template<typename F>
+bool write_atomic( // f(std::FILE *) writes path's new contents (and returns whether it managed to). Either all of them end up on the disk, or path stays the way it was, even if we crash (or lose power) halfway through. Leaves a path+".tmp" behind in the latter case, which gets overwritten next time.
+	const std::string & path
+	, F && f
+) {
+	const auto tmp{path+".tmp"};
+
+	{
+		file file{tmp.c_str(), "wb"};
+
+		if(
+			!file
+			|| !f(static_cast<std::FILE *>(file))
+			|| !sync(static_cast<std::FILE *>(file))
+		) [[unlikely]] {
+			return false;
+		}
+	}
+
+#ifdef _WIN32
+	std::wstring _tmp(static_cast<std::size_t>(MultiByteToWideChar(CP_UTF8, 0, tmp.c_str(), -1, nullptr, 0)), L'\0');
+	std::wstring _path(static_cast<std::size_t>(MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0)), L'\0');
+
+	MultiByteToWideChar(CP_UTF8, 0, tmp.c_str(), -1, _tmp.data(), static_cast<int>(_tmp.size()));
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, _path.data(), static_cast<int>(_path.size()));
+
+	return MoveFileExW(_tmp.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else // !_WIN32
+	if(std::rename(tmp.c_str(), path.c_str()) != 0) [[unlikely]] {
+		return false;
+	}
+
+	const auto separator{path.find_last_of(path_separators())};
+
+	return sync(separator == path.npos ? std::string{"."} : path.substr(0, separator > 0 ? separator : 1)); // The directory entry has to make it to the disk too.
+#endif // _WIN32
+}
+
 template<typename T>
 auto extension(
 	T && path
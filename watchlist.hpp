@@ -0,0 +1,259 @@
+#pragma once
+
+#include "config.hpp"
+#include "flog.hpp"
+#include "util.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace watchlist { // Standing queries (config.json: "watchlist": [...]) whose hits are appended to a per-query log every time new sources get ingested.
+
+/*
+<hash>.hits:
+	"alogw\x02"                    // "alogw\x01" is the same, except that timestamps are in seconds.
+	varint(query.size()) query
+	(
+		varint(time)
+		varint(id.size()) id
+		varint(offset)
+		varint(timestamp) // Milliseconds.
+	)*
+
+A record whose offset is superseded isn't a hit: its source got ingested again (the subs changed), so whatever hits it had before that record no longer apply, and the ones after it are for the new text.
+*/
+
+constexpr std::string_view magic{"alogw\x02", 6};
+constexpr std::string_view magic_v1{"alogw\x01", 6};
+
+struct hit {
+	std::int64_t time; // When the hit was found, i.e. when its source was ingested (seconds since epoch).
+	std::string id; // source::id.
+	std::size_t offset; // Into source::text, or superseded.
+	config::timestamp_type timestamp;
+};
+
+constexpr auto superseded{std::numeric_limits<std::size_t>::max()};
+
+inline
+std::string path(
+	const std::string & directory
+	, const std::string_view query
+) {
+	return directory+util::path_separator()+util::format("%016llx.hits", static_cast<unsigned long long>(util::fnv1a(query)));
+}
+
+namespace detail {
+
+enum class header {
+	missing // Not a log (yet), or a crash cut its header short.
+	, v1
+	, v2
+	, other // Some other query's log, i.e. a hash collision.
+};
+
+inline
+header skip_header( // Advances data past the header.
+	std::string_view * const data
+	, const std::string_view query
+) {
+	const auto v1{data->starts_with(magic_v1)};
+
+	if(!data->starts_with(magic) && !v1) {
+		return header::missing;
+	}
+
+	auto _data{data->substr(magic.size())};
+	std::size_t size;
+
+	if(!util::varint(&_data, &size) || _data.size() < size) [[unlikely]] {
+		return header::missing;
+	}
+
+	if(_data.substr(0, size) != query) [[unlikely]] {
+		return header::other;
+	}
+
+	*data = _data.substr(size);
+
+	return v1 ? header::v1 : header::v2;
+}
+
+template<typename F>
+std::size_t records( // f(hit) for every complete record in data (header already skipped). Returns how many bytes those take up, anything after that got truncated by a crash during append().
+	std::string_view data
+	, const bool v1
+	, F && f
+) {
+	const auto size{data.size()};
+	hit hit;
+
+	while(!data.empty()) {
+		auto _data{data};
+		std::uint64_t time;
+		std::size_t id_size;
+		std::make_unsigned_t<config::timestamp_type> timestamp;
+
+		if(
+			!util::varint(&_data, &time)
+			|| !util::varint(&_data, &id_size)
+			|| _data.size() < id_size
+		) [[unlikely]] {
+			break;
+		}
+
+		hit.id = _data.substr(0, id_size);
+		_data.remove_prefix(id_size);
+
+		if(
+			!util::varint(&_data, &hit.offset)
+			|| !util::varint(&_data, &timestamp)
+		) [[unlikely]] {
+			break;
+		}
+
+		hit.time = static_cast<std::int64_t>(time);
+		hit.timestamp = static_cast<config::timestamp_type>(v1 ? timestamp*1000 : timestamp);
+		data = _data;
+
+		f(std::as_const(hit));
+	}
+
+	return size-data.size();
+}
+
+} // namespace detail
+
+inline
+bool append( // Creates the log (even if there aren't any hits, so that we know the query has already seen everything up to now).
+	const std::string & path
+	, const std::string_view query
+	, const std::span<const hit> hits
+) {
+	const auto exists{util::file_exists(path)};
+
+	if(exists && hits.empty()) {
+		return true;
+	}
+
+	std::string file;
+	std::size_t keep{0}; // Bytes of the existing log that are fine as they are.
+	bool v1{false}; // Old logs stay in seconds, rather than getting rewritten.
+
+	if(exists) {
+		file = util::read<std::string>(path);
+
+		std::string_view data{file};
+
+		switch(detail::skip_header(&data, query)) {
+		case detail::header::missing:
+			break; // Starts over.
+		case detail::header::v1:
+			v1 = true;
+			[[fallthrough]];
+		case detail::header::v2:
+			keep = (file.size()-data.size())+detail::records(data, v1, [](const hit &) {});
+
+			break;
+		case detail::header::other:
+			flog::write(util::format("'%s' doesn't belong to '%.*s'.", path.c_str(), static_cast<int>(query.size()), query.data()), flog::Level::warning); // Otherwise both queries' hits end up in the same log.
+
+			return false;
+		}
+	}
+
+	auto & data{util::thread_buffer()};
+
+	if(keep == 0) {
+		data += magic;
+		util::varint(&data, query.size());
+		data += query;
+	}
+
+	for(const auto & i: hits) {
+		util::varint(&data, static_cast<std::uint64_t>(i.time));
+		util::varint(&data, i.id.size());
+		data += i.id;
+		util::varint(&data, i.offset);
+		util::varint(&data, static_cast<std::make_unsigned_t<config::timestamp_type> >(v1 ? i.timestamp/1000 : i.timestamp));
+	}
+
+	if(keep == 0 || keep < file.size()) { // A new log, or one whose last append() got cut short: everything after the last complete record would hide whatever gets appended after it from read(), forever.
+		if(keep > 0) {
+			flog::write(util::format("'%s': dropping %zu bytes of a truncated record.", path.c_str(), file.size()-keep), flog::Level::warning);
+		}
+
+		return util::write_atomic(path, [&](std::FILE * const _file) {
+			return
+				std::fwrite(file.data(), sizeof(char), keep, _file) == keep
+				&& std::fwrite(data.data(), sizeof(char), data.size(), _file) == data.size()
+			;
+		});
+	}
+
+	util::file _file{path.c_str(), "ab"};
+
+	if(!_file) [[unlikely]] {
+		flog::write(util::format("Unable to open '%s'.", path.c_str()));
+
+		return false;
+	}
+
+	return std::fwrite(data.data(), sizeof(char), data.size(), static_cast<std::FILE *>(_file)) == data.size();
+}
+
+template<typename F>
+bool read( // f(hit) for every hit found at or after since, minus the superseded ones. Superseding records get passed along too (when they're at or after since), so that whoever's polling knows to drop what they got earlier.
+	const std::string & path
+	, const std::string_view query
+	, const std::int64_t since
+	, F && f
+) {
+	const auto file{util::read<std::string>(path)};
+	std::string_view data{file};
+	const auto header{detail::skip_header(&data, query)};
+
+	if(header == detail::header::missing) {
+		return false; // Doesn't exist (yet).
+	}
+
+	if(header == detail::header::other) [[unlikely]] {
+		flog::write(util::format("'%s' doesn't belong to '%.*s'.", path.c_str(), static_cast<int>(query.size()), query.data()), flog::Level::warning); // A hash collision, most likely.
+
+		return false;
+	}
+
+	std::unordered_map<std::string, std::size_t> last; // id -> its last superseding record.
+	std::size_t i{0};
+
+	detail::records(data, header == detail::header::v1, [&](const hit & hit) {
+		if(hit.offset == superseded) [[unlikely]] {
+			last.insert_or_assign(hit.id, i);
+		}
+
+		++i;
+	});
+
+	i = 0;
+	detail::records(data, header == detail::header::v1, [&](const hit & hit) {
+		if(hit.time >= since) {
+			if(const auto j{last.empty() ? last.end() : last.find(hit.id)}; j == last.end() || i >= j->second) [[likely]] {
+				f(hit);
+			}
+		}
+
+		++i;
+	});
+
+	return true;
+}
+
+} // namespace watchlist
@@ -0,0 +1,495 @@
+#pragma once
+
+#include "archive.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class word_index { // Positional inverted index of an archive's words (see util::words()), for whole-word/phrase searches. Positions are word indices, source::words maps them back to offsets into source::text.
+public:
+	word_index() = default;
+
+	explicit word_index(
+		const class archive & archive
+	) {
+		for(const auto & source: archive) {
+			_words += source.words.data.size();
+		}
+
+		_sources = archive.size();
+		_average = _sources > 0 ? static_cast<double>(_words)/static_cast<double>(_sources) : 0.0;
+
+		const auto finish{[&](term & term) { // Done with term.source.
+			term.max = std::max(term.max, saturation(term.tf, archive[term.source].words.data.size()));
+		}};
+
+		for(std::uint32_t i{0}; const auto & source: archive) {
+			const std::string_view text{source.text.data};
+
+			for(std::uint32_t position{0}; position < source.words.data.size(); ++position) {
+				const auto offset{source.words.data[position]};
+				const auto size{std::find_if(text.begin()+offset, text.end(), [](const char c) {return c == ' ' || (c >= '\t' && c <= '\r');})-(text.begin()+offset)};
+				const auto word{text.substr(offset, size)};
+				auto _term{_terms.find(word)};
+
+				if(_term == _terms.end()) {
+					_term = _terms.emplace(std::string{word}, term{}).first;
+				}
+
+				auto & term{_term->second};
+
+				if(term.size == 0 || term.source != i) {
+					if(term.size != 0) {
+						finish(term);
+					}
+
+					term.tf = 0;
+					++term.sources;
+				}
+
+				util::varint(&term.postings, i-term.source);
+				util::varint(&term.postings, term.size != 0 && term.source == i ? position-term.position : position);
+
+				term.source = i;
+				term.position = position;
+				++term.size;
+				++term.tf;
+			}
+
+			++i;
+		}
+
+		for(auto & [_, term]: _terms) {
+			finish(term);
+
+			if(term.sources < skip_min) {
+				continue;
+			}
+
+			std::vector<std::uint64_t> sources, offsets;
+
+			sources.reserve(term.sources);
+			offsets.reserve(term.sources);
+			for(cursor cursor{&term};;) {
+				const auto offset{term.postings.size()-cursor.postings.size()};
+
+				if(!cursor.next()) {
+					break;
+				}
+
+				if(sources.empty() || cursor.source != sources.back()) {
+					sources.emplace_back(cursor.source);
+					offsets.emplace_back(offset);
+				}
+			}
+
+			term.skips = {.sources = util::elias_fano{sources}, .offsets = util::elias_fano{offsets}};
+		}
+	}
+
+	auto size() const {return _terms.size();}
+
+	template<typename F>
+	void for_each( // f(term, number of occurrences) for every term, in no particular order.
+		F && f
+	) const {
+		for(const auto & [term, _term]: _terms) {
+			f(std::string_view{term}, _term.size);
+		}
+	}
+
+	template<typename T, typename F>
+	void find( // f(text, offset, size, timestamp, source) (same as archive::find()'s) for every (non-overlapping) occurrence of terms, one after another.
+		const class archive & archive
+		, const std::span<const archive::source> sources // Some (contiguous) part of archive, see archive::slice().
+		, const T & terms
+		, F && f
+	) const {
+		if(terms.empty()) {
+			return;
+		}
+
+		thread_local std::vector<cursor> cursors;
+
+		cursors.clear();
+		for(const auto & i: terms) {
+			const auto term{_terms.find(std::string_view{i})};
+
+			if(term == _terms.end()) {
+				return; // Any missing term means there's nothing to find.
+			}
+
+			cursors.emplace_back(cursor{&term->second});
+		}
+
+		const auto pivot{static_cast<std::size_t>(std::min_element( // The rarest term drives the search, the rest only get checked.
+			cursors.begin()
+			, cursors.end()
+			, [](const auto & lhs, const auto & rhs) {return lhs.term->size < rhs.term->size;}
+		)-cursors.begin())};
+		const auto
+			begin{static_cast<std::uint32_t>(sources.data()-archive.data())}
+			, end{static_cast<std::uint32_t>(begin+sources.size())}
+		;
+		std::uint32_t source{end}, _end{0}; // Next position that doesn't overlap the previous match.
+
+		for(auto & i: cursors) {
+			i.skip(begin);
+		}
+
+		for(auto & i{cursors[pivot]}; i.next();) {
+			if(i.source < begin) { // No term::skips.
+				continue;
+			} else if(i.source >= end) {
+				break;
+			}
+
+			if(i.position < pivot) {
+				continue;
+			}
+
+			const auto position{i.position-static_cast<std::uint32_t>(pivot)};
+
+			if(i.source != source) {
+				source = i.source;
+				_end = 0;
+			}
+
+			if(position < _end) {
+				continue;
+			}
+
+			if([&] {
+				for(std::size_t j{0}; j < cursors.size(); ++j) {
+					if(j != pivot && !cursors[j].seek(source, position+static_cast<std::uint32_t>(j))) {
+						return false;
+					}
+				}
+
+				return true;
+			}()) {
+				const auto & _source{archive[source]};
+				const auto offset{_source.words.data[position]};
+				const auto _size{(_source.words.data[position+(cursors.size()-1)]+std::string_view{terms.back()}.size())-offset};
+
+				f(
+					std::string_view{_source.text.data}
+					, std::size_t{offset}
+					, _size
+					, _source.events.data.timestamp_at(offset)
+					, _source
+				);
+
+				_end = position+static_cast<std::uint32_t>(cursors.size());
+			}
+		}
+	}
+
+	struct ranked {
+		std::uint32_t source; // Index into archive.
+		double score;
+	};
+
+	template<typename T>
+	void rank( // BM25 top-k of sources (each one being a document) for terms (order doesn't matter), best first. MaxScore skips sources that can't make it into the top-k.
+		const class archive & archive
+		, const std::span<const archive::source> sources // Some (contiguous) part of archive, see archive::slice().
+		, const T & terms
+		, const std::size_t k
+		, std::vector<ranked> * result
+	) const {
+		struct list {
+			source_cursor cursor;
+			double idf;
+			double bound; // Max score this term can contribute.
+		};
+
+		thread_local std::vector<list> lists;
+		thread_local std::vector<double> bounds; // [i] = sum of lists[0..i].bound.
+
+		result->clear();
+		lists.clear();
+		for(const auto & i: terms) {
+			const auto term{_terms.find(std::string_view{i})};
+
+			if(term == _terms.end()) {
+				continue; // Unlike with phrases, the rest of the terms still count.
+			}
+
+			if(std::find_if(lists.begin(), lists.end(), [&](const auto & x) {return x.cursor.postings.term == &term->second;}) != lists.end()) {
+				continue;
+			}
+
+			const auto idf{std::log(1.0+(static_cast<double>(_sources)-term->second.sources+0.5)/(term->second.sources+0.5))};
+
+			lists.emplace_back(list{
+				.cursor = {.postings = cursor{&term->second}}
+				, .idf = idf
+				, .bound = idf*term->second.max
+			});
+		}
+
+		if(lists.empty() || k == 0) {
+			return;
+		}
+
+		std::sort(lists.begin(), lists.end(), [](const auto & lhs, const auto & rhs) {return lhs.bound < rhs.bound;});
+
+		bounds.resize(lists.size());
+		for(double sum{0.0}; auto & i: lists) {
+			bounds[&i-lists.data()] = sum += i.bound;
+		}
+
+		const auto
+			begin{static_cast<std::uint32_t>(sources.data()-archive.data())}
+			, end{static_cast<std::uint32_t>(begin+sources.size())}
+		;
+		const auto worse{[](const ranked & lhs, const ranked & rhs) {return lhs.score > rhs.score || (lhs.score == rhs.score && lhs.source < rhs.source);}}; // Min-heap by score, ties go to the newer (lower index) source.
+		std::size_t essential{0}; // lists[0..essential) can't get a source into the top-k on their own, so they're only used to score sources found by the rest.
+		auto threshold{0.0};
+
+		for(auto & i: lists) {
+			i.cursor.seek(begin);
+		}
+
+		for(;;) {
+			auto source{end};
+
+			for(std::size_t i{essential}; i < lists.size(); ++i) {
+				if(lists[i].cursor.valid) {
+					source = std::min(source, lists[i].cursor.source);
+				}
+			}
+
+			if(source >= end) {
+				break;
+			}
+
+			const auto length{archive[source].words.data.size()};
+			auto score{0.0};
+
+			for(std::size_t i{essential}; i < lists.size(); ++i) {
+				if(auto & cursor{lists[i].cursor}; cursor.valid && cursor.source == source) {
+					score += lists[i].idf*saturation(cursor.tf, length);
+
+					cursor.next();
+				}
+			}
+
+			for(std::size_t i{essential}; i-- > 0;) {
+				if(score+bounds[i] <= threshold) {
+					break;
+				}
+
+				if(auto & cursor{lists[i].cursor}; cursor.seek(source) && cursor.source == source) {
+					score += lists[i].idf*saturation(cursor.tf, length);
+				}
+			}
+
+			if(result->size() < k || score > threshold) {
+				result->emplace_back(ranked{.source = source, .score = score});
+				std::push_heap(result->begin(), result->end(), worse);
+
+				if(result->size() > k) {
+					std::pop_heap(result->begin(), result->end(), worse);
+					result->pop_back();
+				}
+
+				if(result->size() == k) {
+					threshold = result->front().score;
+
+					for(; essential < lists.size() && bounds[essential] <= threshold; ++essential) {
+					}
+				}
+			}
+		}
+
+		std::sort_heap(result->begin(), result->end(), worse);
+	}
+
+	template<typename T, typename F>
+	void find_any( // f(text, offset, size, timestamp, source) for every occurrence of any of the (distinct) terms in sources (indices into archive, sorted), ordered by term.
+		const class archive & archive
+		, const std::span<const std::uint32_t> sources
+		, const T & terms
+		, F && f
+	) const {
+		for(auto j{std::begin(terms)}; j != std::end(terms); ++j) {
+			const auto & i{*j};
+			const auto term{_terms.find(std::string_view{i})};
+
+			if(term == _terms.end()) {
+				continue;
+			}
+
+			if(std::find_if(std::begin(terms), j, [&i](const auto & x) {return std::string_view{x} == std::string_view{i};}) != j) {
+				continue; // "la la land" would get every "la" twice otherwise.
+			}
+
+			cursor cursor{&term->second};
+
+			for(const auto source: sources) {
+				cursor.skip(source);
+
+				if(cursor.seek(source, 0); !cursor.valid) {
+					break;
+				}
+
+				const auto & _source{archive[source]};
+
+				for(; cursor.valid && cursor.source == source; cursor.next()) {
+					const auto offset{_source.words.data[cursor.position]};
+
+					f(
+						std::string_view{_source.text.data}
+						, std::size_t{offset}
+						, std::string_view{i}.size()
+						, _source.events.data.timestamp_at(offset)
+						, _source
+					);
+				}
+			}
+		}
+	}
+
+private:
+	struct term {
+		std::string postings; // varint(source delta), varint(position delta (or position, for the first posting of every source)).
+		std::uint32_t source{0}; // Of the last posting.
+		std::uint32_t position{0}; // ^.
+		std::size_t size{0}; // Number of postings.
+		std::uint32_t sources{0}; // Number of sources that have this term.
+		std::uint32_t tf{0}; // Number of postings in term.source, only used while building.
+		double max{0.0}; // Max saturation() of all sources, see rank().
+		struct {
+			util::elias_fano sources; // Every source that has this term, ascending.
+			util::elias_fano offsets; // Into postings, of the first posting of each of those.
+		} skips; // So that a cursor can jump straight to a source (the first one of a date range, most likely), rather than decode everything before it. Empty for terms in fewer than skip_min sources, those are quick enough to decode anyway.
+	};
+
+	static constexpr std::uint32_t skip_min{64};
+
+	struct cursor { // Decodes term::postings one at a time.
+		const struct term * term;
+		std::string_view postings{term->postings};
+		std::uint32_t source{0};
+		std::uint32_t position{0};
+		bool valid{false}; // Whether (source, position) is an actual posting.
+
+		bool next(
+		) {
+			std::uint32_t _source, _position;
+
+			if(
+				!util::varint(&postings, &_source)
+				|| !util::varint(&postings, &_position)
+			) {
+				return valid = false;
+			}
+
+			position = !valid || _source != 0 ? _position : position+_position;
+			source += _source;
+
+			return valid = true;
+		}
+
+		void skip( // Jumps (forward only) to right before the first posting of the first source >= _source. Only as a hint: without term::skips, this does nothing and seek() walks there as usual.
+			const std::uint32_t _source
+		) {
+			if(term->skips.sources.empty() || (valid && source >= _source)) {
+				return;
+			}
+
+			const auto i{term->skips.sources.lower_bound(_source)};
+			const auto offset{i < term->skips.sources.size() ? static_cast<std::size_t>(term->skips.offsets[i]) : term->postings.size()};
+
+			if(offset <= term->postings.size()-postings.size()) { // Already there (or past it).
+				return;
+			}
+
+			postings = std::string_view{term->postings}.substr(offset);
+			source = i > 0 ? static_cast<std::uint32_t>(term->skips.sources[i-1]) : 0; // Source deltas are relative to the previous posting's.
+			valid = false; // Positions too, except for the first posting of a source (which this is).
+		}
+
+		bool seek( // Advances to the first posting >= (source, position), returns whether it's exactly that.
+			const std::uint32_t _source
+			, const std::uint32_t _position
+		) {
+			for(; !valid || source < _source || (source == _source && position < _position);) {
+				if(!next()) {
+					return false;
+				}
+			}
+
+			return source == _source && position == _position;
+		}
+	};
+
+	struct source_cursor { // Same as cursor, but one source (and the number of its postings) at a time.
+		struct cursor postings;
+		std::uint32_t source{0};
+		std::uint32_t tf{0};
+		bool valid{false};
+
+		bool next(
+		) {
+			if(!postings.valid && !postings.next()) { // Either the first call, or we're done.
+				return valid = false;
+			}
+
+			source = postings.source;
+			tf = 0;
+
+			do {
+				++tf;
+			} while(postings.next() && postings.source == source);
+
+			return valid = true;
+		}
+
+		bool seek( // Advances to the first source >= _source, returns false if there isn't one.
+			const std::uint32_t _source
+		) {
+			if(!valid || source < _source) {
+				postings.skip(_source);
+			}
+
+			for(; !valid || source < _source;) {
+				if(!next()) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+	double saturation( // BM25's term frequency part (without idf).
+		const std::uint32_t tf
+		, const std::size_t length
+	) const {
+		const auto _tf{static_cast<double>(tf)};
+
+		return (_tf*(config::bm25_k1+1.0))/(_tf+config::bm25_k1*((1.0-config::bm25_b)+config::bm25_b*(static_cast<double>(length)/_average)));
+	}
+
+	struct hash {
+		using is_transparent = void;
+
+		std::size_t operator ()(const std::string_view x) const {return std::hash<std::string_view>{}(x);}
+	};
+
+	std::unordered_map<std::string, term, hash, std::equal_to<> > _terms;
+	std::size_t _sources{0};
+	std::size_t _words{0};
+	double _average{0.0}; // Words per source.
+};
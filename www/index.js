@@ -4,17 +4,24 @@ const config_results_chart_colors = [
 	, "Gold"
 	, "MediumSlateBlue"
 ];
+const config_rank = 50; // Number of videos shown by ~ranked searches (the server caps it anyway).
+const config_expand_radius = 512; // Code points of context (each side) shown when hovering over a result.
+const config_expand_line = 10; // Seconds per line of that context.
 const config_results_chart_rtx = 0.5; // Height of the "reflection" (relative to var(--results-chart-height)).
 
 function hms(
-	seconds
+	ms // Timestamps are in milliseconds.
+	, precise = false // Append the milliseconds.
 ) {
+	ms = Math.max(0, Math.round(ms));
+
 	const
-		h = (seconds/60)/60
-		, m = (h % 1)*60
+		h = Math.floor(ms/3600000)
+		, m = Math.floor(ms/60000) % 60
+		, s = Math.floor(ms/1000) % 60
 	;
 
-	return String(Math.floor(h)).padStart(2, '0')+':'+String(Math.floor(m)).padStart(2, '0')+':'+String(Math.floor((m % 1)*60)).padStart(2, '0');
+	return String(h).padStart(2, '0')+':'+String(m).padStart(2, '0')+':'+String(s).padStart(2, '0')+(precise ? '.'+String(ms % 1000).padStart(3, '0') : "");
 }
 
 function strftime(
@@ -70,6 +77,212 @@ function post_json(
 	r.send(request);
 }
 
+class binary_decoder { // Incremental decoder for POST({..., format: "binary"}) responses (see main.cpp for the layout). Produces the same object JSON.parse would.
+	static underflow = {};
+
+	constructor(
+	) {
+		this.buffer = new Uint8Array(0);
+		this.position = 0;
+		this.text_decoder = new TextDecoder;
+		this.json = null;
+		this.count = 0;
+		this.snippets = [];
+		this.archive_index = 0;
+	}
+
+	varint(
+	) {
+		let x = 0;
+
+		for(let shift = 1;; shift *= 128) { // Not using bitwise ops, because those are 32 bit.
+			if(this.position >= this.buffer.length) {
+				throw binary_decoder.underflow;
+			}
+
+			const byte = this.buffer[this.position++];
+
+			x += (byte & 0x7F)*shift;
+
+			if(byte < 0x80) {
+				return x;
+			}
+		}
+	}
+
+	bytes(
+		length
+	) {
+		if(this.position+length > this.buffer.length) {
+			throw binary_decoder.underflow;
+		}
+
+		this.position += length;
+
+		return this.buffer.subarray(this.position-length, this.position);
+	}
+
+	header(
+	) {
+		const view = new DataView(this.bytes(5).buffer, this.position-5+this.buffer.byteOffset, 5);
+
+		if(
+			view.getUint32(0) != 0x616C6F67 // "alog"
+			|| view.getUint8(4) != 5
+		) {
+			throw new Error("Unknown response format.");
+		}
+
+		let json = {search: [], archive: [], pages: [], archive_pages: []};
+
+		this.count = this.varint();
+		json["version"] = this.varint();
+		for(let i = this.varint(); i > 0; --i) {
+			json["archive"].push(this.varint());
+		}
+		for(let i = this.varint(); i > 0; --i) {
+			let page = [];
+
+			for(let j = this.varint(); j > 0; --j) {
+				page.push({begin: this.varint(), end: this.varint()});
+			}
+
+			json["pages"].push(page);
+		}
+		for(let i = json["archive"].length; i > 0; --i) {
+			json["archive_pages"].push(this.varint());
+		}
+
+		this.json = this.count > 0 ? json : {}; // Same as the JSON response.
+	}
+
+	result(
+	) {
+		const s = this.varint();
+		const snippet = s == this.snippets.length ? this.bytes(this.varint()) : null;
+		const t = this.varint();
+		const o = this.varint();
+		const i = this.archive_index+this.varint();
+		const n = this.varint();
+		let h = [];
+
+		for(let j = 0, end = 0, m = this.varint(); j < m; ++j) {
+			const offset = end+this.varint();
+
+			end = offset+this.varint();
+
+			h.push(offset, end-offset);
+		}
+
+		let ts = [t];
+
+		for(let j = 1; j < n; ++j) {
+			const zigzag = this.varint();
+
+			ts.push(ts[j-1]+(zigzag % 2 == 0 ? zigzag/2 : -(zigzag+1)/2));
+		}
+
+		// Nothing is modified until the entire result has been read, in case we run out of data halfway through.
+
+		if(snippet != null) {
+			this.snippets.push(this.text_decoder.decode(snippet));
+		}
+
+		this.archive_index = i;
+
+		let result = {s: this.snippets[s], t: t, o: o, i: i, h: h};
+
+		if(n > 1) {
+			result["ts"] = ts;
+		}
+
+		this.json["search"].push(result);
+	}
+
+	done(
+	) {
+		return this.json != null && (this.count == 0 || this.json["search"].length == this.count);
+	}
+
+	push(
+		chunk
+	) {
+		{
+			const rest = this.buffer.subarray(this.position); // Whatever's left of an incomplete result (or header) from the previous chunk.
+
+			this.buffer = new Uint8Array(rest.length+chunk.length);
+			this.buffer.set(rest);
+			this.buffer.set(chunk, rest.length);
+			this.position = 0;
+		}
+
+		while(!this.done()) {
+			const position = this.position;
+
+			try {
+				if(this.json == null) {
+					this.header();
+				} else {
+					this.result();
+				}
+			} catch(e) {
+				if(e !== binary_decoder.underflow) {
+					throw e;
+				}
+
+				this.position = position;
+
+				break;
+			}
+		}
+	}
+}
+
+async function post_binary(
+	request
+	, callback
+) {
+	const response = await fetch("", {
+		method: "POST"
+		, headers: {"Content-Type": "application/json"}
+		, body: request
+	});
+
+	if(response.status != 200) {
+		return;
+	}
+
+	if(response.headers.get("Content-Type").startsWith("application/json")) { // Errors (and such) are still JSON.
+		callback(await response.json());
+
+		return;
+	}
+
+	let decoder = new binary_decoder;
+
+	if(response.body && response.body.getReader) {
+		const reader = response.body.getReader();
+
+		for(;;) {
+			const {done, value} = await reader.read(); // Decoding a chunk at a time keeps the main thread responsive, unlike JSON.parse(<hundreds of MiBs>).
+
+			if(done) {
+				break;
+			}
+
+			decoder.push(value);
+		}
+	} else {
+		decoder.push(new Uint8Array(await response.arrayBuffer()));
+	}
+
+	if(!decoder.done()) {
+		return; // Truncated response.
+	}
+
+	callback(decoder.json);
+}
+
 const count = document.getElementById("count");
 const context_image = document.getElementById("context-image");
 const context_menu = document.getElementById("context-menu");
@@ -79,25 +292,29 @@ const results_chart_background = document.getElementById("results-chart-backgrou
 const results_chart = document.getElementById("results-chart");
 const results = document.getElementById("results");
 const _search = document.getElementById("_search");
+const _from = document.getElementById("from");
+const _to = document.getElementById("to");
 
 let archive = {archive: [], version: 0};
 let archives = [];
 let context = "";
 let _search_value = _search.value;
+let _search_range = ""; // from+'-'+to, so that changing the dates re-runs the search.
 let page_current = -1;
 let _json = [];
+const session = Array.from(crypto.getRandomValues(new Uint8Array(16)), (x) => x.toString(16).padStart(2, '0')).join(""); // Lets the server reuse the previous search's hits when the new one only extends it.
 
 function yt_dlp_cmd(
 	index
 	, format
 	, t_offset
 	, t_length
+	, t = _json["search"][index]["t"]
 	, yt_dlp_path = "yt-dlp"
 ) {
 	const id = archive["archive"][
 		_json["search"][index]["i"] // I regret my life choices.
 	]["i"];
-	const t = _json["search"][index]["t"];
 
 	return (
 		yt_dlp_path
@@ -107,9 +324,9 @@ function yt_dlp_cmd(
 		+"https://youtu.be/"
 		+id
 		+"' --download-sections '*"
-		+hms(t+t_offset)
+		+hms(t+t_offset*1000, true)
 		+'-'
-		+hms((t+t_offset)+t_length)
+		+hms((t+t_offset*1000)+t_length*1000, true)
 		+"' -o '"
 		+id
 		+'-'
@@ -118,151 +335,403 @@ function yt_dlp_cmd(
 	);
 }
 
-function pages_set(
-	index
+function highlight( // Appends s to element, with the [offset, length] ranges from h (as computed by the server) wrapped in <mark>'s. No regexes, no innerHTML.
+	element
+	, s
+	, h
 ) {
-	if(page_current == index) {
-		return;
-	}
+	const text = (begin, end) => document.createTextNode(s.slice(begin, end).replaceAll(' ', '\u00A0')); // nbsp's, because unless we do this we (might) get (some) misaligned text. "white-space:pre" doesn't completely fix it either.
 
-	if(_json["pages"].length > 1) {
-		results_pages.children.item(Math.max(0, page_current)).style.filter = ""; // Because we need to handle the initial -1.
-		results_pages.children.item(index).style.filter = "brightness(175%)";
+	let k = 0;
+
+	for(let l = 0; l < h.length; l += 2) {
+		let mark = document.createElement("mark");
+
+		mark.appendChild(text(h[l], h[l]+h[l+1]));
+
+		if(h[l] > k) {
+			element.appendChild(text(k, h[l]));
+		}
+		element.appendChild(mark);
+
+		k = h[l]+h[l+1];
 	}
 
-	page_current = index;
+	element.appendChild(text(k, s.length));
+}
 
-	results.style.display = "none"; // Supposedly this should reduce the amount of "layout reflows". Doesn't seem like it does, but whatever.
-	results.innerHTML = "";
+const results_overscan = 32; // Rows rendered above/below the visible ones.
 
-	_json["pages"][index].forEach(i => {
-		const archive_index = _json["search"][i["begin"]]["i"]; // Why do I do this to myself?
-		const video_id = archive["archive"][archive_index]["i"];
+let results_rows = []; // Current page, flattened: -(archive index+1) for headers, "search" index for results.
+let results_offsets = new Float64Array(1); // results_offsets[i] = top of results_rows[i] (px, relative to the table).
+let results_height = {header: 32, result: 20}; // px, including border-spacing. Initial guess, measured on every render.
+let results_elements = new Map; // results_rows index -> <tr>, whatever's currently in the table.
+let results_pool = {header: [], result: []}; // Recycled <tr>'s.
+let results_spacers = [0, 1].map(() => { // Above/below the rendered rows, stand in for everything that isn't.
+	let tr = document.createElement("tr");
+	let td = document.createElement("td");
+
+	td.colSpan = 2;
+	tr.appendChild(td);
+
+	return tr;
+});
+let results_update_pending = false;
+
+function results_row_type(
+	row
+) {
+	return results_rows[row] < 0 ? "header" : "result";
+}
+
+function results_row_create(
+	type
+) {
+	let tr = document.createElement("tr");
+
+	if(type == "header") {
+		let th = document.createElement("th"); // FIXME: The code below is my best attempt at making this shit look exactly how I want it to, and at this point I don't really give a fuck whether it's efficient or not. The "FIXME" is here because despite all my efforts I couldn't get it to stay on a single line in case the element "overflows". My best guess is that it has something to do with "colSpan" being set, but I've wasted enough time on this garbage already.
+
+		th.colSpan = 2;
 
 		{
-			let tr = document.createElement("tr");
-			let th = document.createElement("th"); // FIXME: The code below is my best attempt at making this shit look exactly how I want it to, and at this point I don't really give a fuck whether it's efficient or not. The "FIXME" is here because despite all my efforts I couldn't get it to stay on a single line in case the element "overflows". My best guess is that it has something to do with "colSpan" being set, but I've wasted enough time on this garbage already.
+			let upload_date = document.createElement("span");
 
-			th.colSpan = 2;
+			upload_date.className = "upload-date";
 
-			{
-				let upload_date = document.createElement("span");
+			th.appendChild(upload_date);
+		} {
+			let uarr = document.createElement("a");
 
-				upload_date.className = "upload-date";
-				upload_date.id = video_id;
-				upload_date.innerHTML = strftime(archive["archive"][archive_index]["u"]);
+			uarr.className = "uarr";
+			uarr.href = "#";
+			uarr.innerHTML = "&uarr;";
+			uarr.target = "_self";
 
-				th.appendChild(upload_date);
-			} {
-				let uarr = document.createElement("a");
+			th.appendChild(uarr);
+		} {
+			let title = document.createElement("span");
 
-				uarr.className = "uarr";
-				uarr.href = "#";
-				uarr.innerHTML = "&uarr;";
-				uarr.target = "_self";
+			title.className = "title";
 
-				th.appendChild(uarr);
-			} {
-				let title = document.createElement("span");
+			th.appendChild(title);
+		} {
+			let id = document.createElement("span");
 
-				title.className = "title";
-				title.innerHTML = archive["archive"][archive_index]["t"];
+			id.className = "id";
 
-				th.appendChild(title);
-			} {
-				let id = document.createElement("span");
+			th.appendChild(id);
+		}
 
-				id.className = "id";
-				id.innerHTML = archive["archive"][archive_index]["i"];
+		tr.className = "results-header";
+		tr.appendChild(th);
+	} else {
+		{
+			let td = document.createElement("td");
 
-				th.appendChild(id);
+			if(window.isSecureContext) {
+				let a = document.createElement("a");
+
+				a.className = "timestamp";
+				a.href = "#";
+				a.target = "_self";
+
+				td.appendChild(a);
+			} else {
+				let _td = document.createElement("td");
+
+				_td.className = "timestamp";
+
+				td.appendChild(_td);
 			}
 
-			tr.appendChild(th);
-			results.appendChild(tr);
+			tr.appendChild(td);
+		} {
+			let a = document.createElement("a");
+
+			a.className = "result-a";
+			a.rel = "noreferrer";
+
+			let td = document.createElement("td");
+
+			td.className = "result-td";
+
+			td.appendChild(a);
+			tr.appendChild(td);
 		}
 
-		for(let j = i["begin"]; j < i["end"]; ++j) {
-			let substr = _json["search"][j]["s"];
+		tr.className = "results-result";
+	}
 
-			{
-				// FIXME?: This entire block looks (and *is*) fucking horrible. There *has to be* a better way of doing this. This is also a(n even bigger) waste of resources in case we're not using regexs.
+	return tr;
+}
 
-				let s = new Set;
+function results_row_set(
+	tr
+	, row
+) {
+	if(results_rows[row] < 0) {
+		const archive_index = -(results_rows[row]+1);
+		const th = tr.firstChild;
 
-				for(const i of substr.matchAll(_search_value)) {
-					for(const j of i) {
-						s.add(j);
+		th.children[0].textContent = strftime(archive["archive"][archive_index]["u"]);
+		th.children[2].textContent = archive["archive"][archive_index]["t"];
+		th.children[3].textContent = archive["archive"][archive_index]["i"];
+	} else {
+		const j = results_rows[row];
+		const video_id = archive["archive"][_json["search"][j]["i"]]["i"];
+		const timestamp = tr.children[0].firstChild;
+		const a = tr.children[1].firstChild;
+
+		timestamp.textContent = hms(_json["search"][j]["t"]);
+		timestamp.title = Object.hasOwn(_json["search"][j], "ts") ? _json["search"][j]["ts"].map((x) => hms(x)).join('\n') : "";
+
+		a.dataset.j = j; // For the click handler(s) below.
+		a.href = "https://youtu.be/"+video_id+"?t="+Math.floor(_json["search"][j]["t"]/1000);
+		a.replaceChildren();
+		highlight(a, _json["search"][j]["s"], _json["search"][j]["h"]);
+		a.title = _json["search"][j]["expanded"] ?? ""; // See the mouseover handler below.
+		a.style.textDecoration = _json["search"][j]["visited"] == true ? "line-through" : "";
+	}
+}
 
-						break; // FIXME: ??????
-					}
-				}
+function results_layout(
+) {
+	results_offsets = new Float64Array(results_rows.length+1);
 
-				for(const i of s) {
-					substr = substr.replaceAll(i, "<mark>"+i+"</mark>");
-				}
+	for(let i = 0; i < results_rows.length; ++i) {
+		results_offsets[i+1] = results_offsets[i]+results_height[results_row_type(i)];
+	}
+}
+
+function results_row_at( // Index of the row at y (px, relative to the table).
+	y
+) {
+	let begin = 0, end = results_rows.length;
+
+	while(begin < end) {
+		const middle = (begin+end) >> 1;
+
+		if(results_offsets[middle+1] <= y) {
+			begin = middle+1;
+		} else {
+			end = middle;
+		}
+	}
+
+	return begin;
+}
+
+function results_update( // Renders whatever rows are (about to be) visible, and nothing else.
+	measure = true
+) {
+	if(results_rows.length == 0) {
+		return;
+	}
+
+	const y = -results.getBoundingClientRect().top;
+	const first = Math.max(0, results_row_at(y)-results_overscan);
+	const last = Math.min(results_rows.length, results_row_at(y+window.innerHeight)+1+results_overscan);
+
+	for(const [row, tr] of results_elements) {
+		if(row < first || row >= last) {
+			results_pool[results_row_type(row)].push(tr);
+			results_elements.delete(row);
+		}
+	}
+
+	let children = [results_spacers[0]];
+
+	for(let row = first; row < last; ++row) {
+		let tr = results_elements.get(row);
+
+		if(tr === undefined) {
+			const type = results_row_type(row);
+
+			tr = results_pool[type].pop() ?? results_row_create(type);
+
+			results_row_set(tr, row);
+			results_elements.set(row, tr);
+		}
+
+		children.push(tr);
+	}
+
+	children.push(results_spacers[1]);
+
+	results_spacers[0].style.height = String(results_offsets[first])+"px";
+	results_spacers[1].style.height = String(results_offsets[results_rows.length]-results_offsets[last])+"px";
+
+	results.replaceChildren(...children);
+
+	if(measure) { // The initial guess is (probably) wrong, and fonts/zoom can change things anyway. Measuring the distance between consecutive rows takes border-spacing into account.
+		let height = {header: [0, 0], result: [0, 0]};
+
+		for(let i = 1; i+2 < children.length; ++i) {
+			const type = results_row_type(first+(i-1));
+
+			height[type][0] += children[i+1].getBoundingClientRect().top-children[i].getBoundingClientRect().top;
+			height[type][1] += 1;
+		}
+
+		let changed = false;
+
+		for(const type of ["header", "result"]) {
+			if(height[type][1] > 0 && Math.abs(height[type][0]/height[type][1]-results_height[type]) > 0.5) {
+				results_height[type] = height[type][0]/height[type][1];
+				changed = true;
 			}
+		}
 
-			substr = substr.replaceAll(" ", "&nbsp;"); // This is extremely retarded, but unless we do this we (might) get (some) misaligned text. "white-space:pre" doesn't completely fix it either.
+		if(changed) {
+			results_layout();
+			results_update(false);
+		}
+	}
+}
 
-			let result = document.createElement("tr");
+function results_set(
+	rows
+) {
+	for(const [row, tr] of results_elements) {
+		results_pool[results_row_type(row)].push(tr);
+	}
+	results_elements.clear();
 
-			{
-				let td = document.createElement("td");
+	results_rows = rows;
 
-				if(window.isSecureContext) {
-					let a = document.createElement("a");
+	results_layout();
 
-					a.className = "timestamp";
-					a.href = "#";
-					a.innerHTML = hms(_json["search"][j]["t"]);
-					a.onclick = function() {
-						navigator.clipboard.writeText(yt_dlp_cmd(j, "134+140", -5, 15)); // TODO: Configurable args.
+	if(rows.length > 0) {
+		results_update();
+	} else {
+		results.replaceChildren();
+	}
+}
 
-						return false;
-					};
-					a.target = "_self";
+function results_scroll_to( // Scrolls to the header of archive_index (on the current page).
+	archive_index
+) {
+	const row = results_rows.indexOf(-(archive_index+1));
 
-					td.appendChild(a);
-				} else {
-					let _td = document.createElement("td");
+	if(row < 0) {
+		return;
+	}
 
-					_td.className = "timestamp";
-					_td.innerHTML = hms(_json["search"][j]["t"]);
+	window.scrollTo(0, window.scrollY+results.getBoundingClientRect().top+results_offsets[row]);
 
-					td.appendChild(_td);
-				}
+	results_update();
+}
 
-				result.appendChild(td);
-			} {
-				let a = document.createElement("a");
+window.addEventListener("scroll", function() {
+	if(results_update_pending) {
+		return;
+	}
 
-				a.addEventListener("click", function(e) {
-					_json["search"][j]["visited"] = true; // Has to be done to keep track of visited links through "page flips" (and in private mode).
-
-					a.style.textDecoration = "line-through";
-				});
-				a.className = "result-a";
-				a.href = "https://youtu.be/"+video_id+"?t="+_json["search"][j]["t"];
-				a.innerHTML = substr;
-				a.rel = "noreferrer";
-				if(_json["search"][j]["visited"] == true) {
-					a.style.textDecoration = "line-through";
-				}
+	results_update_pending = true;
 
-				let td = document.createElement("td");
+	requestAnimationFrame(function() {
+		results_update_pending = false;
 
-				td.className = "result-td";
+		results_update();
+	});
+});
+window.addEventListener("resize", () => results_update());
 
-				td.appendChild(a);
-				result.appendChild(td);
+results.addEventListener("click", function(e) { // Rows get recycled, so everything is handled here rather than per element.
+	const a = e.target.closest("a");
+
+	if(
+		a == null
+		|| a.closest("tr") == null
+		|| a.closest("tr").lastChild.firstChild.dataset.j === undefined // Headers.
+	) {
+		return;
+	}
+
+	const j = Number(a.closest("tr").lastChild.firstChild.dataset.j);
+
+	if(a.className == "timestamp") {
+		navigator.clipboard.writeText(yt_dlp_cmd(j, "134+140", -5, 15)); // TODO: Configurable args.
+
+		e.preventDefault();
+	} else if(a.className == "result-a") {
+		_json["search"][j]["visited"] = true; // Has to be done to keep track of visited links through "page flips" (and in private mode).
+
+		a.style.textDecoration = "line-through";
+	}
+});
+
+results.addEventListener("mouseover", function(e) { // More context (than fits in a row) on hover, fetched only for the results that actually get hovered.
+	const a = e.target.closest("a.result-a");
+
+	if(
+		a == null
+		|| a.dataset.j === undefined
+	) {
+		return;
+	}
+
+	const j = Number(a.dataset.j);
+	const result = _json["search"][j];
+
+	if(Object.hasOwn(result, "expanded")) {
+		return;
+	}
+
+	result["expanded"] = ""; // Pending, so that moving the mouse around doesn't send the same request over and over.
+
+	post_json(
+		JSON.stringify({
+			expand: context
+			, source: result["i"]
+			, offset: result["o"]
+			, length: result["h"][1]
+			, radius: config_expand_radius
+		})
+		, function(json) {
+			let lines = [];
+
+			for(let k = 0; k < json["ts"].length; k += 2) { // A line per timestamp change is way too many lines, so every config_expand_line seconds instead.
+				if(lines.length == 0 || json["ts"][k+1]-lines[lines.length-1][1] >= config_expand_line*1000) {
+					lines.push([json["ts"][k], json["ts"][k+1]]);
+				}
 			}
 
-			results.appendChild(result);
+			result["expanded"] = lines.map((x, k) => hms(x[1])+' '+json["s"].slice(x[0], k+1 < lines.length ? lines[k+1][0] : undefined).trim()).join('\n');
+
+			if(a.dataset.j == j) { // Still the same row (rows get recycled).
+				a.title = result["expanded"];
+			}
+		}
+	);
+});
+
+function pages_set(
+	index
+) {
+	if(page_current == index) {
+		return;
+	}
+
+	if(_json["pages"].length > 1) {
+		results_pages.children.item(Math.max(0, page_current)).style.filter = ""; // Because we need to handle the initial -1.
+		results_pages.children.item(index).style.filter = "brightness(175%)";
+	}
+
+	page_current = index;
+
+	let rows = [];
+
+	_json["pages"][index].forEach(i => {
+		rows.push(-(_json["search"][i["begin"]]["i"]+1)); // Why do I do this to myself?
+
+		for(let j = i["begin"]; j < i["end"]; ++j) {
+			rows.push(j);
 		}
 	});
 
-	results.style.display = "";
+	results_set(rows);
 }
 
 function clear_results(
@@ -273,7 +742,7 @@ function clear_results(
 	results_chart_container.style.display = "";
 	results_chart_background.innerHTML = "";
 	results_chart.innerHTML = "";
-	results.innerHTML = "";
+	results_set([]);
 }
 
 function parse(
@@ -405,8 +874,9 @@ function parse(
 				_bar.target = "_self";
 				_bar.onclick = function() {
 					pages_set(_json["archive_pages"][index]);
+					results_scroll_to(index); // The header might not even exist (yet), so "#id" won't do.
 
-					return true; // TODO/FIXME: I'm assuming pages_set will (always) exec first which might or might not be true.
+					return false;
 				};
 
 				bar_fg.appendChild(_bar);
@@ -415,7 +885,7 @@ function parse(
 	}
 
 	{
-		const _count = json["search"].length;
+		const _count = json["archive"].reduce((a, b) => a+b, 0); // Hits, not (merged) results.
 
 		count.innerHTML = _count > 0 ? String(_count) : "";
 	}
@@ -423,27 +893,92 @@ function parse(
 	pages_set(0);
 }
 
-document.getElementById("search").addEventListener("submit", (e) => {
-	e.preventDefault();
-
+function search(
+) {
 	const __search_value = _search.value.toLowerCase(); // Server expects a lowercase string.
+	const __search_range = _from.value+'-'+_to.value;
 
-	if(_search_value != __search_value) {
+	if(
+		_search_value != __search_value
+		|| _search_range != __search_range
+	) {
 		_search_value = __search_value;
+		_search_range = __search_range;
 
-		post_json(
+		const words = _search_value.length > 2 && _search_value.startsWith('"') && _search_value.endsWith('"'); // "whole words only", the subs don't have any double quotes anyway.
+		const rank = !words && _search_value.length > 1 && _search_value.startsWith('~'); // ~best videos for these words.
+
+		post_binary(
 			JSON.stringify({
 				archive: context
-				, substr: _search_value
+				, substr: words ? _search_value.slice(1, -1) : rank ? _search_value.slice(1) : _search_value
+				, words: words
+				, rank: rank ? config_rank : undefined
 				, substr_size: Math.ceil(max_line_length()-"00:00:00".length)
+				, format: "binary"
+				, session: session
+				, from: isNaN(_from.valueAsNumber) ? undefined : _from.valueAsNumber/1000 // upload_date is midnight UTC, same as valueAsNumber.
+				, to: isNaN(_to.valueAsNumber) ? undefined : _to.valueAsNumber/1000
 			})
 			, parse
 		);
 	}
+}
+
+document.getElementById("search").addEventListener("submit", (e) => {
+	e.preventDefault();
+
+	search();
 
 	_search.select();
 });
 
+{
+	const suggestions = document.getElementById("suggestions");
+	let suggestions_request = 0; // Responses can arrive out of order, only the latest one counts.
+
+	_search.addEventListener("input", (e) => {
+		if(e.inputType == "insertReplacementText" || e.inputType === undefined) { // Picked a suggestion.
+			return;
+		}
+
+		const value = _search.value.toLowerCase();
+		const prefix = value.replace(/^["~]/, ""); // Same syntax as search().
+		const request = ++suggestions_request;
+
+		if(prefix.length < 2) {
+			suggestions.replaceChildren();
+
+			return;
+		}
+
+		post_json(
+			JSON.stringify({suggest: context, prefix: prefix})
+			, (json) => {
+				if(request != suggestions_request) {
+					return;
+				}
+
+				suggestions.replaceChildren(...json.map(i => {
+					let option = document.createElement("option");
+
+					option.value = value.slice(0, value.length-prefix.length)+i["w"];
+
+					return option;
+				}));
+			}
+		);
+	});
+}
+
+for(const i of [_from, _to]) {
+	i.addEventListener("change", () => {
+		if(_search_value != "") {
+			search();
+		}
+	});
+}
+
 function store_results(
 ) {
 	if(!window.isSecureContext) {
@@ -458,7 +993,6 @@ function store_results(
 
 		for(let i = 0; i < _json["search"].length; ++i) {
 			const curr_id = _json["search"][i]["i"];
-			const curr_cmd = yt_dlp_cmd(i, "134+140", -5, 15)+'\n'; // TODO: Configurable args.
 
 			if(curr_id != prev_id) {
 				prev_id = curr_id;
@@ -466,12 +1000,16 @@ function store_results(
 				data += "\n\n# "+archive["archive"][curr_id]["t"]+'\n';
 			}
 
-			if(curr_cmd != prev_cmd) {
-				prev_cmd = curr_cmd;
+			for(const t of _json["search"][i]["ts"] ?? [_json["search"][i]["t"]]) {
+				const curr_cmd = yt_dlp_cmd(i, "134+140", -5, 15, t)+'\n'; // TODO: Configurable args.
 
-				data += "# "+_json["search"][i]["s"]+'\n';
-				data += "# https://youtu.be/"+archive["archive"][curr_id]["i"]+"?t="+_json["search"][i]["t"]+'\n';
-				data += curr_cmd+'\n';
+				if(curr_cmd != prev_cmd) {
+					prev_cmd = curr_cmd;
+
+					data += "# "+_json["search"][i]["s"]+'\n';
+					data += "# https://youtu.be/"+archive["archive"][curr_id]["i"]+"?t="+Math.floor(t/1000)+'\n';
+					data += curr_cmd+'\n';
+				}
 			}
 		}
 	}